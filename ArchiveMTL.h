@@ -0,0 +1,701 @@
+/*
+  ArchiveMTL.h
+
+  C++ code solution for a compressed columnar archive of Wavefront MTL libraries
+
+  An archive stores the material table column by column, for shipping
+  libraries to devices where parsing the text is too slow. Every statement is
+  a column with a presence bitmap (one bit per material) followed by the
+  values of the materials that have it, encoded as in the binary cache
+  (BinaryMTL.h). Strings (names, texture files, spectral files) are interned
+  in a string pool of their own block and written as pool index, so a column
+  is decoded from its own block alone.
+
+	Header     "MTLA", version, materials, blocks
+	Directory  keyword, codec, raw size, packed size and offset of each block
+	Blocks     #info, #name, a column per statement, #custom
+	Block      string pool (count, strings), then presence bitmap and values
+
+  Every block is compressed on its own with a small LZ77 codec (LZ below) and
+  stored as is when that does not make it smaller, so a reader decompresses
+  only the blocks it asks for. Columns without any value are left out.
+
+	std::string data = mtl::to_archive(file);
+
+	mtl::Archive archive;
+	archive.open(data.data(), data.size());
+
+	std::vector<mtl::Material> materials;
+	archive.decode(materials, { "Kd", "map_Kd" });  // Names, Kd and map_Kd
+
+  Only a full decode (no keywords) reads the user registered statements.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "BinaryMTL.h"
+
+namespace mtl
+{
+	constexpr uint32_t ARCHIVE_VERSION = 2;
+
+	// LZ77 with 64 KB window. A sequence is a token (literal length << 4 |
+	// match length - 4, 15 continues in 255 runs), the literals, a uint16
+	// offset and the match length continuation. The last sequence has
+	// literals only.
+
+	struct LZ
+	{
+		static void compress(const char* data, size_t size, std::string& out);
+
+		static bool decompress(const char* data, size_t size, char* out, size_t raw);
+
+	private:
+
+		static uint32_t load(const char* p) { uint32_t v; std::memcpy(&v, p, sizeof v); return v; }
+
+		static void length(std::string& out, size_t n) { for (; n >= 255; n -= 255) out.push_back(static_cast<char>(255)); out.push_back(static_cast<char>(n)); }
+	};
+
+	class Archive
+	{
+	public:
+
+		Archive() : data(nullptr), length(0), count(0) {}
+
+		bool open(const char* archive, size_t bytes);
+
+		size_t size() const { return count; }
+
+		std::vector<std::string> columns() const;
+
+		bool decode(std::vector<Material>& materials, const std::vector<std::string>& keywords = {}) const;
+
+		bool information(std::vector<std::string>& info) const;
+
+		size_t bytes() const { return length; }
+
+	private:
+
+		struct Block
+		{
+			std::string keyword;
+			uint8_t     codec;  // 0 stored, 1 LZ
+			uint32_t    raw;    // Size after decompression
+			uint32_t    packed; // Size in the archive
+			uint64_t    offset; // Offset in the archive
+		};
+
+		const Block* find(const std::string& keyword) const;
+
+		bool block(const Block& item, std::string& raw) const;
+
+		bool pooled(const Block& item, std::string& raw, std::vector<std::string>& pool, size_t& body) const;
+
+		static bool strings(BinaryReader& in, std::vector<std::string>& list);
+
+		bool column(const Block& item, uint8_t id, std::vector<Material>& materials) const;
+
+		bool custom(const Block& item, std::vector<Material>& materials) const;
+
+		const char* data; // Archive buffer, owned by the caller
+
+		size_t length;
+
+		uint32_t count; // Materials
+
+		std::vector<Block> blocks;
+	};
+
+	std::string to_archive(Load& load);
+
+	bool from_archive(const char* data, size_t size, Load& load);
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline void LZ::compress(const char* data, size_t size, std::string& out)
+	{
+		constexpr int BITS = 14;
+
+		std::vector<uint32_t> table(size_t(1) << BITS, UINT32_MAX); // Last position of each hashed 4 bytes
+
+		size_t anchor(0), i(0);
+
+		auto sequence = [&](size_t literals, size_t match, size_t offset)
+		{
+			const size_t extra = match ? match - 4 : 0;
+
+			out.push_back(static_cast<char>(std::min<size_t>(literals, 15) << 4 | std::min<size_t>(extra, 15)));
+
+			if (literals >= 15) length(out, literals - 15);
+
+			out.append(data + anchor, literals);
+
+			if (!match) return;
+
+			out.push_back(static_cast<char>(offset & 0xFF));
+			out.push_back(static_cast<char>(offset >> 8));
+
+			if (extra >= 15) length(out, extra - 15);
+		};
+
+		while (i + 4 <= size)
+		{
+			const uint32_t sequence4 = load(data + i);
+
+			uint32_t& slot = table[(sequence4 * 2654435761u) >> (32 - BITS)];
+
+			const size_t ref = slot;
+
+			slot = static_cast<uint32_t>(i);
+
+			if (ref == UINT32_MAX || i - ref > 0xFFFF || load(data + ref) != sequence4)
+			{
+				i++;
+
+				continue;
+			}
+
+			size_t match(4);
+
+			while (i + match < size && data[ref + match] == data[i + match])
+				match++;
+
+			sequence(i - anchor, match, i - ref);
+
+			i += match;
+
+			anchor = i;
+		}
+
+		if (anchor < size || size == 0)
+			sequence(size - anchor, 0, 0);
+	}
+
+	inline bool LZ::decompress(const char* data, size_t size, char* out, size_t raw)
+	{
+		const auto* in = reinterpret_cast<const unsigned char*>(data);
+
+		const auto* end = in + size;
+
+		size_t o(0);
+
+		auto extend = [&](size_t& n)
+		{
+			for (unsigned char byte = 255; byte == 255;)
+			{
+				if (in == end) return false;
+
+				byte = *in++;
+
+				n += byte;
+			}
+
+			return true;
+		};
+
+		while (in < end)
+		{
+			const unsigned char token = *in++;
+
+			size_t literals = token >> 4;
+
+			if (literals == 15 && !extend(literals)) return false;
+
+			if (literals > static_cast<size_t>(end - in) || literals > raw - o) return false;
+
+			std::memcpy(out + o, in, literals);
+
+			in += literals;
+
+			o += literals;
+
+			if (in == end) break; // Last sequence
+
+			if (end - in < 2) return false;
+
+			const size_t offset = in[0] | static_cast<size_t>(in[1]) << 8;
+
+			in += 2;
+
+			size_t match = (token & 15);
+
+			if (match == 15 && !extend(match)) return false;
+
+			match += 4;
+
+			if (offset == 0 || offset > o || match > raw - o) return false;
+
+			for (size_t k = 0; k < match; k++, o++) // Byte by byte, the match may overlap its own output
+				out[o] = out[o - offset];
+		}
+
+		return o == raw;
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	// Keywords of the statements in visit order
+
+	struct ArchiveKeywords
+	{
+		std::vector<std::string>& keywords;
+
+		void operator()(const char* keyword, const Parse&) { keywords.push_back(keyword); }
+	};
+
+	// Appends the statements of material number row to their columns
+
+	struct ArchiveRow
+	{
+		std::vector<BinaryWriter>& columns;
+
+		std::vector<std::unordered_map<std::string, uint32_t>>& pools; // String pool of each column
+
+		size_t row;
+
+		size_t id;
+
+		template <typename T>
+		void operator()(const char*, const T& item)
+		{
+			BinaryWriter& out = columns[id];
+
+			auto& pool = pools[id++];
+
+			if (!item.isParsed()) return;
+
+			out.str()[row / 8] |= static_cast<char>(1 << (row % 8));
+
+			BinaryFields{ out, 0, &pool }.value(item);
+		}
+	};
+
+	// Block of the archive, the string pool of the block in index order then the body
+
+	inline std::string archive_block(const std::unordered_map<std::string, uint32_t>& pool, const std::string& body)
+	{
+		std::vector<const std::string*> order(pool.size());
+
+		for (const auto& item : pool)
+			order[item.second] = &item.first;
+
+		BinaryWriter out;
+
+		out.put(static_cast<uint32_t>(order.size()));
+
+		for (const auto* item : order)
+			out.put(*item);
+
+		out.put(body.data(), body.size());
+
+		return std::move(out.str());
+	}
+
+	inline std::string to_archive(Load& load)
+	{
+		std::vector<const Material*> materials;
+
+		for (const auto& material : load.materials())
+			if (material.name.isParsed())
+				materials.push_back(&material);
+
+		const size_t n = materials.size();
+
+		const size_t bitmap = (n + 7) / 8;
+
+		std::vector<std::pair<std::string, std::string>> blocks; // Keyword, raw block
+
+		BinaryWriter info;
+
+		info.put(static_cast<uint32_t>(load.information().size()));
+
+		for (const auto& line : load.information())
+			info.put(line);
+
+		blocks.emplace_back("#info", std::move(info.str()));
+
+		std::unordered_map<std::string, uint32_t> pool; // Strings of the block being written
+
+		BinaryWriter names;
+
+		BinaryFields interned{ names, 0, &pool };
+
+		for (const auto* material : materials)
+			interned.text(material->name.value);
+
+		blocks.emplace_back("#name", archive_block(pool, names.str()));
+
+		// One column per statement, string pool, presence bitmap then the values
+
+		std::vector<std::string> keywords;
+
+		const Material defaults;
+
+		visit(defaults, ArchiveKeywords{ keywords });
+
+		std::vector<BinaryWriter> columns(keywords.size());
+
+		std::vector<std::unordered_map<std::string, uint32_t>> pools(keywords.size());
+
+		for (auto& column : columns)
+			column.str().assign(bitmap, '\0');
+
+		for (size_t i = 0; i < n; i++)
+			visit(*materials[i], ArchiveRow{ columns, pools, i, 0 });
+
+		for (size_t id = 0; id < columns.size(); id++)
+			if (columns[id].size() > bitmap)
+				blocks.emplace_back(keywords[id], archive_block(pools[id], columns[id].str()));
+
+		pool.clear();
+
+		BinaryWriter custom;
+
+		custom.str().assign(bitmap, '\0');
+
+		BinaryFields fields{ custom, 0, &pool };
+
+		bool any(false);
+
+		for (size_t i = 0; i < n; i++)
+		{
+			uint32_t parsed(0);
+
+			for (const auto& item : materials[i]->custom)
+				parsed += item.isParsed();
+
+			if (!parsed) continue;
+
+			custom.str()[i / 8] |= static_cast<char>(1 << (i % 8));
+
+			custom.put(parsed);
+
+			for (const auto& item : materials[i]->custom)
+			{
+				if (!item.isParsed()) continue;
+
+				fields.text(item.keyword);
+
+				custom.put(static_cast<uint8_t>(item.type));
+
+				switch (item.type)
+				{
+				case Statement::color:   fields.value(item.color); break;
+				case Statement::scalar:  fields.value(item.scalar); break;
+				case Statement::texture: fields.value(item.texture); break;
+				case Statement::string:  fields.value(item.text); break;
+				}
+			}
+
+			any = true;
+		}
+
+		if (any) blocks.emplace_back("#custom", archive_block(pool, custom.str()));
+
+		BinaryWriter out;
+
+		out.put("MTLA", 4);
+		out.put(ARCHIVE_VERSION);
+		out.put(static_cast<uint32_t>(n));
+		out.put(static_cast<uint32_t>(blocks.size()));
+
+		std::vector<size_t> entries;
+
+		for (const auto& item : blocks)
+		{
+			out.put(item.first);
+
+			entries.push_back(out.size());
+
+			out.put(static_cast<uint8_t>(0));
+			out.put(static_cast<uint32_t>(0));
+			out.put(static_cast<uint32_t>(0));
+			out.put(static_cast<uint64_t>(0));
+		}
+
+		std::string packed;
+
+		for (size_t i = 0; i < blocks.size(); i++)
+		{
+			const std::string& raw = blocks[i].second;
+
+			packed.clear();
+
+			LZ::compress(raw.data(), raw.size(), packed);
+
+			const bool smaller = packed.size() < raw.size();
+
+			const std::string& stored = smaller ? packed : raw;
+
+			out.patch(entries[i], static_cast<uint8_t>(smaller));
+			out.patch(entries[i] + 1, static_cast<uint32_t>(raw.size()));
+			out.patch(entries[i] + 5, static_cast<uint32_t>(stored.size()));
+			out.patch(entries[i] + 9, static_cast<uint64_t>(out.size()));
+
+			out.put(stored.data(), stored.size());
+		}
+
+		return std::move(out.str());
+	}
+
+	inline bool Archive::open(const char* archive, size_t bytes)
+	{
+		data = nullptr;
+
+		blocks.clear();
+
+		BinaryReader in(archive, bytes);
+
+		char magic[4];
+
+		uint32_t version, total;
+
+		if (!in.get(magic) || std::memcmp(magic, "MTLA", 4) != 0 || !in.get(version) || version != ARCHIVE_VERSION) return false;
+
+		if (!in.get(count) || !in.get(total) || total > in.remaining() / 21) return false;
+
+		blocks.resize(total);
+
+		for (auto& item : blocks)
+		{
+			if (!in.get(item.keyword) || !in.get(item.codec) || !in.get(item.raw) || !in.get(item.packed) || !in.get(item.offset)) return false;
+
+			if (item.codec > 1 || item.offset > bytes || item.packed > bytes - item.offset || (item.codec == 0 && item.packed != item.raw)) return false;
+
+			if (item.codec == 1 && item.raw > static_cast<uint64_t>(item.packed) * 256) return false; // Beyond the ratio of LZ
+		}
+
+		data = archive;
+
+		length = bytes;
+
+		return true;
+	}
+
+	inline const Archive::Block* Archive::find(const std::string& keyword) const
+	{
+		for (const auto& item : blocks)
+			if (item.keyword == keyword)
+				return &item;
+
+		return nullptr;
+	}
+
+	inline bool Archive::block(const Block& item, std::string& raw) const
+	{
+		if (item.codec == 0)
+		{
+			raw.assign(data + item.offset, item.packed);
+
+			return true;
+		}
+
+		raw.resize(item.raw);
+
+		return LZ::decompress(data + item.offset, item.packed, &raw[0], item.raw);
+	}
+
+	inline std::vector<std::string> Archive::columns() const
+	{
+		std::vector<std::string> list;
+
+		for (const auto& item : blocks)
+			if (item.keyword[0] != '#')
+				list.push_back(item.keyword);
+
+		return list;
+	}
+
+	inline bool Archive::pooled(const Block& item, std::string& raw, std::vector<std::string>& pool, size_t& body) const
+	{
+		if (!block(item, raw)) return false;
+
+		BinaryReader in(raw.data(), raw.size());
+
+		if (!strings(in, pool)) return false;
+
+		body = raw.size() - in.remaining(); // Offset of the bitmap and values
+
+		return true;
+	}
+
+	inline bool Archive::strings(BinaryReader& in, std::vector<std::string>& list)
+	{
+		uint32_t total;
+
+		if (!in.get(total) || total > in.remaining() / sizeof(uint32_t)) return false;
+
+		list.resize(total);
+
+		for (auto& text : list)
+			if (!in.get(text)) return false;
+
+		return true;
+	}
+
+	inline bool Archive::information(std::vector<std::string>& info) const
+	{
+		const Block* item = data ? find("#info") : nullptr;
+
+		std::string raw;
+
+		if (!item || !block(*item, raw)) return false;
+
+		BinaryReader in(raw.data(), raw.size());
+
+		return strings(in, info);
+	}
+
+	inline bool Archive::column(const Block& item, uint8_t id, std::vector<Material>& materials) const
+	{
+		std::string raw;
+
+		std::vector<std::string> pool;
+
+		size_t body;
+
+		const size_t bitmap = (materials.size() + 7) / 8;
+
+		if (!pooled(item, raw, pool, body) || raw.size() - body < bitmap) return false;
+
+		const char* present = raw.data() + body;
+
+		BinaryReader in(present + bitmap, raw.size() - body - bitmap);
+
+		BinaryValues values{ in, &pool };
+
+		for (size_t i = 0; i < materials.size(); i++)
+		{
+			if (!(present[i / 8] >> (i % 8) & 1)) continue;
+
+			BinaryValues::Select select{ values, id, 0, false, false };
+
+			visit(materials[i], select);
+
+			if (!select.found || !select.good) return false;
+		}
+
+		return true;
+	}
+
+	inline bool Archive::custom(const Block& item, std::vector<Material>& materials) const
+	{
+		std::string raw;
+
+		std::vector<std::string> pool;
+
+		size_t body;
+
+		const size_t bitmap = (materials.size() + 7) / 8;
+
+		if (!pooled(item, raw, pool, body) || raw.size() - body < bitmap) return false;
+
+		const char* present = raw.data() + body;
+
+		BinaryReader in(present + bitmap, raw.size() - body - bitmap);
+
+		BinaryValues values{ in, &pool };
+
+		for (size_t i = 0; i < materials.size(); i++)
+		{
+			if (!(present[i / 8] >> (i % 8) & 1)) continue;
+
+			uint32_t total;
+
+			if (!in.get(total) || total > in.remaining()) return false;
+
+			materials[i].custom.resize(total);
+
+			for (auto& entry : materials[i].custom)
+			{
+				uint8_t type;
+
+				if (!values.text(entry.keyword) || !in.get(type) || type > 3) return false;
+
+				entry.type = static_cast<Statement>(type);
+
+				bool good(false);
+
+				switch (entry.type)
+				{
+				case Statement::color:   good = values.value(entry.color); break;
+				case Statement::scalar:  good = values.value(entry.scalar); break;
+				case Statement::texture: good = values.value(entry.texture); break;
+				case Statement::string:  good = values.value(entry.text); break;
+				}
+
+				if (!good) return false;
+
+				entry.parsed();
+			}
+		}
+
+		return true;
+	}
+
+	inline bool Archive::decode(std::vector<Material>& materials, const std::vector<std::string>& keywords) const
+	{
+		if (!data) return false;
+
+		std::vector<std::string> pool;
+
+		std::string raw;
+
+		size_t body;
+
+		const Block* names = find("#name");
+
+		if (!names || !pooled(*names, raw, pool, body) || raw.size() - body != count * sizeof(uint32_t)) return false;
+
+		materials.clear();
+
+		materials.resize(count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t index;
+
+			std::memcpy(&index, raw.data() + body + i * sizeof index, sizeof index);
+
+			if (index >= pool.size()) return false;
+
+			materials[i].name = pool[index];
+		}
+
+		std::vector<std::string> fields;
+
+		const Material defaults;
+
+		visit(defaults, ArchiveKeywords{ fields });
+
+		for (size_t id = 0; id < fields.size(); id++)
+		{
+			if (!keywords.empty() && std::find(keywords.begin(), keywords.end(), fields[id]) == keywords.end()) continue;
+
+			const Block* item = find(fields[id]);
+
+			if (item && !column(*item, static_cast<uint8_t>(id), materials)) return false;
+		}
+
+		const Block* item = keywords.empty() ? find("#custom") : nullptr;
+
+		return !item || custom(*item, materials);
+	}
+
+	inline bool from_archive(const char* data, size_t size, Load& load)
+	{
+		Archive archive;
+
+		return archive.open(data, size) && archive.decode(load.materials()) && archive.information(load.information()) && !load.materials().empty();
+	}
+}
@@ -0,0 +1,943 @@
+/*
+  BinaryMTL.h
+
+  C++ code solution for a binary cache of Wavefront MTL libraries
+
+  A parsed library is written once to a compact binary form and read back
+  without any text parsing. All offsets are relative to the start of the
+  buffer, so the cache can be memory mapped and used in place. Each material
+  is a separate record found through an offset table, so single materials can
+  be decoded without touching the rest.
+
+	Header    magic "MTLB", version, counts and section offsets
+	Index     uint64 offset of each material record, plus end offset
+	Info      uint32 length + bytes for each header comment line
+	Records   name, then (field id, value) for every parsed field, 0xFF ends
+	Names     minimal perfect hash of the material names, order of the file
+
+  Fields are numbered in the order of mtl::visit. Numbers are stored little
+  endian as in memory; the cache is meant for the platform that wrote it.
+
+  The name hash is built with hash and displace (CHD): names are hashed once
+  into buckets of about 5, and every bucket stores the displacement that puts
+  its names in free slots of a table with one slot per name. The records are
+  written in slot order, so the slot of a name is the index of its record.
+  Binary::find hashes the name once, reads the displacement of its bucket and
+  compares the name of the record at that index, so a lookup is one hash and
+  one string compare and reads only the displacements, about 6.4 bits per
+  name. A duplicate name is found at its first material; the later ones
+  follow the slots in file order. To restore the order of the file, a uint32
+  position per record follows the displacements, so the names section costs
+  about 38 bits per material in total; the positions are only read when a
+  whole library is decoded.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "WavefrontMTL.h"
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace mtl
+{
+	constexpr uint32_t BINARY_VERSION = 4;
+
+	struct BinaryHeader
+	{
+		char     magic[4]; // "MTLB"
+		uint32_t version;  // BINARY_VERSION
+		uint64_t count;    // Number of materials
+		uint64_t infos;    // Number of information lines
+		uint64_t index;    // Offset of material offset table (count + 1 entries)
+		uint64_t info;     // Offset of information lines
+		uint64_t size;     // Size of the cache in bytes
+		uint64_t names;    // Offset of the name hash (0 if none)
+	};
+
+	struct NameHash
+	{
+		uint64_t              seed;         // Seed of the name hash
+		std::vector<uint32_t> displacement; // Displacement of each bucket
+		std::vector<uint32_t> place;        // Slot of each name
+
+		bool build(const std::vector<std::string_view>& names);
+
+		static uint64_t mix(uint64_t x)
+		{
+			x ^= x >> 30;
+			x *= 0xBF58476D1CE4E5B9ull;
+			x ^= x >> 27;
+			x *= 0x94D049BB133111EBull;
+
+			return x ^ (x >> 31);
+		}
+
+		static uint64_t hash(std::string_view name, uint64_t seed)
+		{
+			uint64_t h = 14695981039346656037ull ^ seed;
+
+			for (const char c : name)
+			{
+				h ^= static_cast<unsigned char>(c);
+				h *= 1099511628211ull;
+			}
+
+			return mix(h);
+		}
+
+		static size_t bucket(uint64_t h, size_t buckets) { return static_cast<size_t>((h >> 32) % buckets); }
+
+		static size_t slot(uint64_t h, uint32_t d, size_t slots) { return static_cast<size_t>(mix(h + d * 0x9E3779B97F4A7C15ull) % slots); }
+
+		static size_t buckets(size_t names) { return names / 5 + 1; }
+	};
+
+	class BinaryWriter
+	{
+	public:
+
+		std::string& str() { return buffer; }
+
+		template <typename T>
+		void put(const T& value) { buffer.append(reinterpret_cast<const char*>(&value), sizeof value); }
+
+		void put(const void* data, size_t size) { buffer.append(static_cast<const char*>(data), size); }
+
+		void put(const std::string& text)
+		{
+			put(static_cast<uint32_t>(text.size()));
+
+			buffer.append(text);
+		}
+
+		template <typename T>
+		void patch(size_t offset, const T& value) { std::memcpy(&buffer[offset], &value, sizeof value); }
+
+		size_t size() const { return buffer.size(); }
+
+		void align(size_t n) { buffer.resize((buffer.size() + n - 1) / n * n, '\0'); }
+
+	private:
+
+		std::string buffer;
+	};
+
+	class BinaryReader
+	{
+	public:
+
+		BinaryReader(const char* data, size_t size) : p(data), end(data + size), good(true) {}
+
+		template <typename T>
+		bool get(T& value)
+		{
+			if (static_cast<size_t>(end - p) < sizeof value) return good = false;
+
+			std::memcpy(&value, p, sizeof value);
+
+			p += sizeof value;
+
+			return true;
+		}
+
+		bool get(std::string& text)
+		{
+			uint32_t length;
+
+			if (!get(length) || static_cast<size_t>(end - p) < length) return good = false;
+
+			text.assign(p, length);
+
+			p += length;
+
+			return true;
+		}
+
+		bool get(std::string_view& text)
+		{
+			uint32_t length;
+
+			if (!get(length) || static_cast<size_t>(end - p) < length) return good = false;
+
+			text = std::string_view(p, length);
+
+			p += length;
+
+			return true;
+		}
+
+		size_t remaining() const { return static_cast<size_t>(end - p); }
+
+		bool ok() const { return good; }
+
+	private:
+
+		const char* p;
+
+		const char* end;
+
+		bool good;
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	// Writes every parsed field of a material as (field id, value)
+
+	struct BinaryFields
+	{
+		BinaryWriter& out;
+
+		uint8_t id;
+
+		std::unordered_map<std::string, uint32_t>* pool = nullptr; // Strings written as pool index (ArchiveMTL.h)
+
+		void text(const std::string& item)
+		{
+			if (!pool) return out.put(item);
+
+			out.put(pool->emplace(item, static_cast<uint32_t>(pool->size())).first->second);
+		}
+
+		template <typename T>
+		void field(const T& item)
+		{
+			if (item.isParsed())
+			{
+				out.put(id);
+
+				value(item);
+			}
+
+			id++;
+		}
+
+		template <typename T>
+		void operator()(const char*, const T& item) { field(item); }
+
+		void value(const Value<double>& item) { out.put(item.value); }
+
+		void value(const Value<int>& item) { out.put(static_cast<int32_t>(item.value)); }
+
+		void value(const Value<bool>& item) { out.put(static_cast<uint8_t>(item.value)); }
+
+		void value(const Value<char>& item) { out.put(item.value); }
+
+		void value(const Value<std::string>& item) { text(item.value); }
+
+		void value(const Model& item) { out.put(static_cast<int32_t>(item.base)); out.put(static_cast<int32_t>(item.gain)); }
+
+		void value(const uvw& item) { out.put(item.u); out.put(item.v); out.put(item.w); }
+
+		void value(const rgb& item) { out.put(item.r); out.put(item.g); out.put(item.b); out.put(static_cast<uint8_t>(item.encoding)); }
+
+		void value(const xyz& item) { out.put(item.x); out.put(item.y); out.put(item.z); }
+
+		void value(const Spectral& item) { text(item.file); out.put(item.factor); }
+
+		void value(const Opacity& item) { out.put(item.d); out.put(static_cast<uint8_t>(item.halo)); }
+
+		void value(const Color& item)
+		{
+			BinaryFields fields{ out, 0, pool };
+
+			fields.field(item.color);
+			fields.field(item.color_space);
+			fields.field(item.spectral);
+
+			out.put(static_cast<uint8_t>(0xFF));
+		}
+
+		void value(const Texture& item)
+		{
+			BinaryFields fields{ out, 0, pool };
+
+			fields.field(item.file);
+
+			visit_options(item, fields);
+
+			out.put(static_cast<uint8_t>(0xFF));
+		}
+
+		void value(const Reflection& item)
+		{
+			BinaryFields fields{ out, 0, pool };
+
+			visit_reflection(item, fields);
+
+			out.put(static_cast<uint8_t>(0xFF));
+		}
+	};
+
+	// Reads (field id, value) pairs written by BinaryFields
+
+	struct BinaryValues
+	{
+		BinaryReader& in;
+
+		const std::vector<std::string>* pool = nullptr; // Strings read as pool index (ArchiveMTL.h)
+
+		bool text(std::string& item)
+		{
+			if (!pool) return in.get(item);
+
+			uint32_t index;
+
+			if (!in.get(index) || index >= pool->size()) return false;
+
+			item = (*pool)[index];
+
+			return true;
+		}
+
+		bool value(Value<double>& item) { double v; return in.get(v) && (item = v, true); }
+
+		bool value(Value<int>& item) { int32_t v; return in.get(v) && (item = static_cast<int>(v), true); }
+
+		bool value(Value<bool>& item) { uint8_t v; return in.get(v) && (item = v != 0, true); }
+
+		bool value(Value<char>& item) { char v; return in.get(v) && (item = v, true); }
+
+		bool value(Value<std::string>& item) { std::string v; return text(v) && (item = v, true); }
+
+		bool value(Model& item)
+		{
+			int32_t base, gain;
+
+			if (!in.get(base) || !in.get(gain)) return false;
+
+			item.base = base;
+			item.gain = gain;
+
+			return item.parsed();
+		}
+
+		bool value(uvw& item) { return in.get(item.u) && in.get(item.v) && in.get(item.w) && item.parsed(); }
+
+		bool value(rgb& item)
+		{
+			uint8_t encoding;
+
+			if (!in.get(item.r) || !in.get(item.g) || !in.get(item.b) || !in.get(encoding) || encoding > 1) return false;
+
+			item.encoding = static_cast<Encoding>(encoding);
+
+			return item.parsed();
+		}
+
+		bool value(xyz& item) { return in.get(item.x) && in.get(item.y) && in.get(item.z) && item.parsed(); }
+
+		bool value(Spectral& item) { return text(item.file) && in.get(item.factor) && item.parsed(); }
+
+		bool value(Opacity& item)
+		{
+			uint8_t halo;
+
+			if (!in.get(item.d) || !in.get(halo)) return false;
+
+			item.halo = halo != 0;
+
+			return item.parsed();
+		}
+
+		// Calls value() on the field with the given id in the order of the visitor
+
+		struct Select
+		{
+			BinaryValues& values;
+
+			uint8_t id;
+
+			uint8_t n;
+
+			bool found;
+
+			bool good;
+
+			template <typename T>
+			void operator()(const char*, T& item)
+			{
+				if (n++ != id || found) return;
+
+				found = true;
+
+				good = values.value(item);
+			}
+		};
+
+		template <typename T, typename Fields>
+		bool fields(T& item, Fields&& each)
+		{
+			uint8_t id;
+
+			while (in.get(id) && id != 0xFF)
+			{
+				Select select{ *this, id, 0, false, false };
+
+				each(item, select);
+
+				if (!select.found || !select.good) return false;
+			}
+
+			return in.ok() && item.parsed();
+		}
+
+		bool value(Color& item)
+		{
+			return fields(item, [](Color& c, Select& s) { s("", c.color); s("", c.color_space); s("", c.spectral); });
+		}
+
+		bool value(Texture& item)
+		{
+			return fields(item, [](Texture& t, Select& s) { s("", t.file); visit_options(t, s); });
+		}
+
+		bool value(Reflection& item)
+		{
+			return fields(item, [](Reflection& r, Select& s) { visit_reflection(r, s); });
+		}
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline void to_binary(const Material& material, BinaryWriter& out)
+	{
+		out.put(material.name.value);
+
+		BinaryFields fields{ out, 0 };
+
+		visit(material, fields);
+
+		uint32_t custom(0);
+
+		for (const auto& item : material.custom)
+			custom += item.isParsed();
+
+		if (custom)
+		{
+			out.put(static_cast<uint8_t>(0xFE));
+
+			out.put(custom);
+
+			for (const auto& item : material.custom)
+			{
+				if (!item.isParsed()) continue;
+
+				out.put(item.keyword);
+
+				out.put(static_cast<uint8_t>(item.type));
+
+				switch (item.type)
+				{
+				case Statement::color:   fields.value(item.color); break;
+				case Statement::scalar:  fields.value(item.scalar); break;
+				case Statement::texture: fields.value(item.texture); break;
+				case Statement::string:  fields.value(item.text); break;
+				}
+			}
+		}
+
+		out.put(static_cast<uint8_t>(0xFF));
+	}
+
+	inline bool from_binary(const char* data, size_t size, Material& material)
+	{
+		BinaryReader in(data, size);
+
+		BinaryValues values{ in };
+
+		if (!values.value(material.name)) return false;
+
+		uint8_t id;
+
+		while (in.get(id) && id != 0xFF)
+		{
+			if (id == 0xFE)
+			{
+				uint32_t count;
+
+				if (!in.get(count) || count > in.remaining()) return false;
+
+				material.custom.resize(count);
+
+				for (auto& item : material.custom)
+				{
+					uint8_t type;
+
+					if (!in.get(item.keyword) || !in.get(type) || type > 3) return false;
+
+					item.type = static_cast<Statement>(type);
+
+					bool good(false);
+
+					switch (item.type)
+					{
+					case Statement::color:   good = values.value(item.color); break;
+					case Statement::scalar:  good = values.value(item.scalar); break;
+					case Statement::texture: good = values.value(item.texture); break;
+					case Statement::string:  good = values.value(item.text); break;
+					}
+
+					if (!good) return false;
+
+					item.parsed();
+				}
+
+				continue;
+			}
+
+			BinaryValues::Select select{ values, id, 0, false, false };
+
+			visit(material, select);
+
+			if (!select.found || !select.good) return false;
+		}
+
+		return in.ok();
+	}
+
+	inline bool NameHash::build(const std::vector<std::string_view>& names)
+	{
+		const size_t n = names.size();
+
+		const size_t r = buckets(n);
+
+		std::vector<uint64_t> hashes(n);
+
+		std::vector<std::vector<uint32_t>> members(r);
+
+		std::vector<size_t> order(r);
+
+		std::vector<bool> taken(n);
+
+		std::vector<size_t> slots;
+
+		for (seed = 0; seed < 64; seed++)
+		{
+			displacement.assign(r, 0);
+
+			place.assign(n, 0);
+
+			taken.assign(n, false);
+
+			for (auto& list : members)
+				list.clear();
+
+			for (size_t i = 0; i < n; i++)
+			{
+				hashes[i] = hash(names[i], seed);
+
+				members[bucket(hashes[i], r)].push_back(static_cast<uint32_t>(i));
+			}
+
+			for (size_t i = 0; i < r; i++)
+				order[i] = i;
+
+			std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return members[a].size() > members[b].size(); });
+
+			bool placed(true);
+
+			for (const size_t b : order)
+			{
+				const auto& list = members[b];
+
+				if (list.empty()) break;
+
+				uint32_t d(0);
+
+				const uint64_t tries = std::min<uint64_t>(64 * static_cast<uint64_t>(n) + 1024, UINT32_MAX); // d is stored as uint32
+
+				for (; d < tries; d++)
+				{
+					slots.clear();
+
+					bool free(true);
+
+					for (const uint32_t key : list)
+					{
+						const size_t s = slot(hashes[key], d, n);
+
+						if (taken[s] || std::find(slots.begin(), slots.end(), s) != slots.end())
+						{
+							free = false;
+
+							break;
+						}
+
+						slots.push_back(s);
+					}
+
+					if (free) break;
+				}
+
+				if (slots.size() != list.size())
+				{
+					placed = false; // Names with equal hashes, try the next seed
+
+					break;
+				}
+
+				displacement[b] = d;
+
+				for (size_t i = 0; i < list.size(); i++)
+				{
+					taken[slots[i]] = true;
+
+					place[list[i]] = static_cast<uint32_t>(slots[i]);
+				}
+			}
+
+			if (placed) return true;
+		}
+
+		return false;
+	}
+
+	inline std::string to_binary(Load& load)
+	{
+		BinaryWriter out;
+
+		auto& materials = load.materials();
+
+		auto& information = load.information();
+
+		uint64_t count(0);
+
+		for (const auto& material : materials)
+			count += material.name.isParsed();
+
+		BinaryHeader header = { { 'M', 'T', 'L', 'B' }, BINARY_VERSION, count, information.size(), 0, 0, 0, 0 };
+
+		out.put(header);
+
+		header.index = out.size();
+
+		for (uint64_t i = 0; i <= count; i++)
+			out.put(static_cast<uint64_t>(0));
+
+		header.info = out.size();
+
+		for (const auto& line : information)
+			out.put(line);
+
+		std::vector<const Material*> named; // Named materials in file order
+
+		std::vector<std::string_view> names; // Unique names, first material of each in file order
+
+		std::vector<uint32_t> records; // Position in named of each record, slot order when hashed
+
+		std::vector<uint32_t> duplicates;
+
+		std::unordered_set<std::string_view> unique;
+
+		for (const auto& material : materials)
+		{
+			if (!material.name.isParsed()) continue;
+
+			if (unique.insert(material.name.value).second)
+			{
+				names.push_back(material.name.value);
+
+				records.push_back(static_cast<uint32_t>(named.size()));
+			}
+			else
+				duplicates.push_back(static_cast<uint32_t>(named.size()));
+
+			named.push_back(&material);
+		}
+
+		NameHash hash;
+
+		const bool hashed = !names.empty() && hash.build(names);
+
+		if (hashed)
+		{
+			std::vector<uint32_t> slots(records.size());
+
+			for (size_t i = 0; i < records.size(); i++)
+				slots[hash.place[i]] = records[i];
+
+			records.swap(slots);
+
+			records.insert(records.end(), duplicates.begin(), duplicates.end());
+		}
+		else
+		{
+			records.resize(named.size());
+
+			for (size_t i = 0; i < records.size(); i++)
+				records[i] = static_cast<uint32_t>(i);
+		}
+
+		for (size_t i = 0; i < records.size(); i++)
+		{
+			out.align(8);
+
+			out.patch(header.index + i * sizeof(uint64_t), static_cast<uint64_t>(out.size()));
+
+			to_binary(*named[records[i]], out);
+		}
+
+		out.patch(header.index + count * sizeof(uint64_t), static_cast<uint64_t>(out.size()));
+
+		if (hashed)
+		{
+			out.align(8);
+
+			header.names = out.size();
+
+			out.put(hash.seed);
+			out.put(static_cast<uint32_t>(hash.displacement.size()));
+			out.put(static_cast<uint32_t>(hash.place.size()));
+			out.put(hash.displacement.data(), hash.displacement.size() * sizeof(uint32_t));
+			out.put(records.data(), records.size() * sizeof(uint32_t));
+		}
+
+		header.size = out.size();
+
+		out.patch(0, header);
+
+		return std::move(out.str());
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	class Binary
+	{
+	public:
+
+		Binary() : seed(0), buckets(0), slots(0), data(nullptr), length(0) { std::memset(&header, 0, sizeof header); }
+
+		bool open(const char* cache, size_t bytes);
+
+		size_t size() const { return static_cast<size_t>(header.count); }
+
+		std::string_view name(size_t index) const;
+
+		bool material(size_t index, Material& material) const;
+
+		bool information(std::vector<std::string>& info) const;
+
+		bool find(std::string_view name, size_t& index) const;
+
+		bool lookup(std::string_view name, Material& material) const;
+
+		size_t record(size_t index, const char*& record) const;
+
+		size_t position(size_t index) const;
+
+		const char* buffer() const { return data; }
+
+		size_t bytes() const { return length; }
+
+	private:
+
+		uint64_t offset(size_t index) const
+		{
+			uint64_t value;
+
+			std::memcpy(&value, data + header.index + index * sizeof value, sizeof value);
+
+			return value;
+		}
+
+		uint32_t table(size_t index) const
+		{
+			uint32_t value;
+
+			std::memcpy(&value, data + header.names + sizeof(uint64_t) + (2 + index) * sizeof value, sizeof value);
+
+			return value;
+		}
+
+		uint64_t seed; // Name hash seed
+
+		uint32_t buckets; // Name hash buckets
+
+		uint32_t slots; // Name hash slots
+
+		const char* data; // Cache buffer, owned by the caller
+
+		size_t length; // Size of buffer
+
+		BinaryHeader header;
+	};
+
+	inline bool Binary::open(const char* cache, size_t bytes)
+	{
+		data = nullptr;
+
+		length = 0;
+
+		if (!cache || bytes < sizeof header) return false;
+
+		std::memcpy(&header, cache, sizeof header);
+
+		if (std::memcmp(header.magic, "MTLB", 4) != 0 || header.version != BINARY_VERSION || header.size > bytes)
+			return false;
+
+		if (header.info > header.size || header.infos > (header.size - header.info) / sizeof(uint32_t))
+			return false;
+
+		if (header.index > header.size || header.count >= (header.size - header.index) / sizeof(uint64_t))
+			return false;
+
+		data = cache;
+
+		length = static_cast<size_t>(header.size);
+
+		for (size_t i = 0; i <= size(); i++)
+		{
+			if (offset(i) > length || (i && offset(i) < offset(i - 1)))
+			{
+				data = nullptr;
+
+				return false;
+			}
+		}
+
+		slots = buckets = 0;
+
+		if (header.names)
+		{
+			const size_t fixed = sizeof seed + sizeof buckets + sizeof slots;
+
+			if (header.names > length || length - header.names < fixed)
+				return data = nullptr, false;
+
+			std::memcpy(&seed, data + header.names, sizeof seed);
+			std::memcpy(&buckets, data + header.names + sizeof seed, sizeof buckets);
+			std::memcpy(&slots, data + header.names + sizeof seed + sizeof buckets, sizeof slots);
+
+			const uint64_t tables = (static_cast<uint64_t>(buckets) + size()) * sizeof(uint32_t);
+
+			if (buckets == 0 || slots == 0 || slots > size() || tables > length - header.names - fixed)
+				return data = nullptr, false;
+		}
+
+		return true;
+	}
+
+	inline bool Binary::find(std::string_view name, size_t& index) const
+	{
+		if (!data) return false;
+
+		if (slots == 0)
+		{
+			for (index = 0; index < size(); index++)
+				if (this->name(index) == name) return true;
+
+			return false;
+		}
+
+		const uint64_t h = NameHash::hash(name, seed);
+
+		const uint32_t d = table(NameHash::bucket(h, buckets));
+
+		index = NameHash::slot(h, d, slots); // Records are in slot order
+
+		return this->name(index) == name;
+	}
+
+	inline bool Binary::lookup(std::string_view name, Material& material) const
+	{
+		size_t index;
+
+		return find(name, index) && this->material(index, material);
+	}
+
+	inline size_t Binary::record(size_t index, const char*& record) const
+	{
+		if (!data || index >= size()) return 0;
+
+		const uint64_t begin = offset(index);
+
+		record = data + begin;
+
+		return static_cast<size_t>(offset(index + 1) - begin);
+	}
+
+	inline size_t Binary::position(size_t index) const
+	{
+		if (!data || index >= size()) return size();
+
+		return slots ? table(buckets + index) : index;
+	}
+
+	inline std::string_view Binary::name(size_t index) const
+	{
+		const char* p = nullptr;
+
+		const size_t size = record(index, p);
+
+		if (size == 0) return std::string_view();
+
+		BinaryReader in(p, size);
+
+		std::string_view text;
+
+		in.get(text);
+
+		return text;
+	}
+
+	inline bool Binary::material(size_t index, Material& material) const
+	{
+		const char* p = nullptr;
+
+		const size_t size = record(index, p);
+
+		if (size == 0) return false;
+
+		return from_binary(p, size, material);
+	}
+
+	inline bool Binary::information(std::vector<std::string>& info) const
+	{
+		if (!data) return false;
+
+		BinaryReader in(data + header.info, length - static_cast<size_t>(header.info));
+
+		info.resize(static_cast<size_t>(header.infos));
+
+		for (auto& line : info)
+			if (!in.get(line)) return false;
+
+		return true;
+	}
+
+	inline bool from_binary(const char* data, size_t size, Load& load)
+	{
+		Binary binary;
+
+		if (!binary.open(data, size)) return false;
+
+		load.materials().clear();
+
+		load.materials().resize(binary.size());
+
+		std::vector<bool> done(binary.size());
+
+		for (size_t i = 0; i < binary.size(); i++)
+		{
+			const size_t position = binary.position(i); // Records are in name hash order
+
+			if (position >= done.size() || done[position] || !binary.material(i, load.materials()[position])) return false;
+
+			done[position] = true;
+		}
+
+		return binary.information(load.information()) && !load.materials().empty();
+	}
+}
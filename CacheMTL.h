@@ -0,0 +1,300 @@
+/*
+  CacheMTL.h
+
+  C++ code solution for out-of-core access to large Wavefront MTL libraries
+
+  A Cache keeps a binary cache (BinaryMTL.h) memory mapped and decodes
+  materials on demand, by index or by name. Decoded materials are kept in a
+  least recently used list under a byte budget; a material that does not fit
+  pushes out the ones used longest ago. Only the pages of the records that
+  are asked for are read from the file.
+
+	mtl::Cache cache(4 << 20);                    // 4 MB of decoded materials
+	cache.load("world.mtlb");
+
+	auto material = cache.get("Brick");           // Decoded on a miss
+	auto next = cache.get(42);
+
+  get() returns a shared pointer, so a material stays valid while it is held
+  even if the cache evicts it. A resident material is counted as the size of
+  Material, 6296 bytes on a 64 bit build, plus the size of its record, which
+  covers its strings, so a budget of 4 MB holds at most about 650 materials.
+  A material larger than the whole budget is returned without being cached
+  and evicts nothing. The cache may be used from several threads; decoding
+  runs outside the lock.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "BinaryMTL.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace mtl
+{
+	struct CacheStats
+	{
+		uint64_t hits;      // Materials found resident
+		uint64_t misses;    // Materials decoded
+		uint64_t evictions; // Materials pushed out by the budget
+		size_t   resident;  // Materials resident
+		size_t   bytes;     // Bytes resident
+	};
+
+	class Cache
+	{
+	public:
+
+		explicit Cache(size_t budget = 16 << 20) : limit(budget), map(nullptr), length(0), stats{ 0, 0, 0, 0, 0 } {}
+
+		~Cache() { close(); }
+
+		Cache(const Cache&) = delete;
+
+		Cache& operator=(const Cache&) = delete;
+
+		bool load(const std::string& path);
+
+		bool open(const char* data, size_t size);
+
+		void close();
+
+		size_t size() const { return binary.size(); }
+
+		std::shared_ptr<const Material> get(size_t index);
+
+		std::shared_ptr<const Material> get(std::string_view name);
+
+		void budget(size_t bytes);
+
+		void clear();
+
+		CacheStats statistics() const;
+
+	private:
+
+		struct Entry
+		{
+			size_t                          index;
+			size_t                          bytes;
+			std::shared_ptr<const Material> material;
+		};
+
+		void evict();
+
+		size_t limit; // Budget in bytes
+
+		void* map; // Mapped file, if loaded
+
+		size_t length; // Size of the mapping
+
+		std::vector<char> buffer; // File contents where mapping is not available
+
+		Binary binary;
+
+		mutable std::mutex lock; // Guards the members below
+
+		std::list<Entry> recent; // Most recently used first
+
+		std::unordered_map<size_t, std::list<Entry>::iterator> resident; // By material index
+
+		CacheStats stats;
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline bool Cache::load(const std::string& path)
+	{
+		close();
+
+#if !defined(_WIN32)
+		const int fd = ::open(path.c_str(), O_RDONLY);
+
+		if (fd < 0) return false;
+
+		struct stat st;
+
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+		{
+			length = static_cast<size_t>(st.st_size);
+
+			map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (map == MAP_FAILED)
+			{
+				map = nullptr;
+
+				length = 0;
+			}
+		}
+
+		::close(fd);
+
+		if (map)
+		{
+			madvise(map, length, MADV_RANDOM); // Records are read one at a time
+
+			return binary.open(static_cast<const char*>(map), length);
+		}
+#endif
+
+		FILE* file = fopen(path.c_str(), "rb");
+
+		if (!file) return false;
+
+		char block[65536];
+
+		size_t read;
+
+		while ((read = fread(block, 1, sizeof block, file)) != 0)
+			buffer.insert(buffer.end(), block, block + read);
+
+		fclose(file);
+
+		return binary.open(buffer.data(), buffer.size());
+	}
+
+	inline bool Cache::open(const char* data, size_t size)
+	{
+		close();
+
+		return binary.open(data, size);
+	}
+
+	inline void Cache::close()
+	{
+		clear();
+
+#if !defined(_WIN32)
+		if (map) munmap(map, length);
+#endif
+		map = nullptr;
+
+		length = 0;
+
+		buffer.clear();
+
+		binary = Binary();
+	}
+
+	inline std::shared_ptr<const Material> Cache::get(size_t index)
+	{
+		if (index >= binary.size()) return nullptr;
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			const auto found = resident.find(index);
+
+			if (found != resident.end())
+			{
+				recent.splice(recent.begin(), recent, found->second);
+
+				stats.hits++;
+
+				return found->second->material;
+			}
+
+			stats.misses++;
+		}
+
+		const char* record = nullptr;
+
+		const size_t size = binary.record(index, record);
+
+		auto material = std::make_shared<Material>();
+
+		if (!from_binary(record, size, *material)) return nullptr;
+
+		const size_t bytes = sizeof(Material) + size;
+
+		std::lock_guard<std::mutex> guard(lock);
+
+		if (bytes > limit) return material; // Would evict everything and itself
+
+		const auto found = resident.find(index);
+
+		if (found != resident.end()) // Decoded by another thread meanwhile
+			return found->second->material;
+
+		recent.push_front({ index, bytes, material });
+
+		resident.emplace(index, recent.begin());
+
+		stats.bytes += recent.front().bytes;
+
+		evict();
+
+		return material;
+	}
+
+	inline std::shared_ptr<const Material> Cache::get(std::string_view name)
+	{
+		size_t index;
+
+		return binary.find(name, index) ? get(index) : nullptr;
+	}
+
+	inline void Cache::evict()
+	{
+		while (stats.bytes > limit && !recent.empty())
+		{
+			stats.bytes -= recent.back().bytes;
+
+			resident.erase(recent.back().index);
+
+			recent.pop_back();
+
+			stats.evictions++;
+		}
+	}
+
+	inline void Cache::budget(size_t bytes)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		limit = bytes;
+
+		evict();
+	}
+
+	inline void Cache::clear()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		recent.clear();
+
+		resident.clear();
+
+		stats.bytes = 0;
+	}
+
+	inline CacheStats Cache::statistics() const
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		CacheStats current = stats;
+
+		current.resident = resident.size();
+
+		return current;
+	}
+}
@@ -0,0 +1,352 @@
+/*
+  ClientMTL.h
+
+  C++ code solution for asking the mtld material server for Wavefront MTL materials
+
+  mtld (tools/mtld.cpp) keeps parsed libraries resident, reloads them when
+  they change on disk and answers requests over a Unix domain socket, so short
+  lived tools get materials without parsing the library again.
+
+	mtl::Client client;
+	client.connect();                                  // Default socket
+
+	client.lookup("/assets/scene.mtl", "Brick", material);
+	client.batch("/assets/scene.mtl", names, materials);
+
+	mtl::Shared shared;                                // Bulk access
+	client.attach("/assets/scene.mtl", shared);
+
+  Libraries are named by path and loaded by the server the first time they
+  are asked for. Materials are returned as binary cache records (BinaryMTL.h);
+  attach() maps the whole library from the shared memory segment the server
+  publishes it in (SharedMTL.h).
+
+  Every message is a frame: uint32 length and the bytes. A request holds the
+  request id and its strings (uint32 length + bytes), a reply a status byte
+  (0 ok, 1 error) and the result or error message.
+
+	load     library                  segment name of the library
+	lookup   library, name            record, empty if not found
+	batch    library, count, names    count, then a record per name
+	stats    -                        text
+
+  Not available on Windows.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "SharedMTL.h"
+
+#include <cerrno>
+#include <cstdlib>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+namespace mtl
+{
+	constexpr uint32_t SERVER_FRAME_LIMIT = 1u << 28; // Largest frame accepted, 256 MB
+
+	enum class Request : uint8_t { load = 1, lookup, batch, stats };
+
+	bool send_frame(int socket, const std::string& frame);
+
+	bool receive_frame(int socket, std::string& frame);
+
+	std::string server_socket();
+
+	class Client
+	{
+	public:
+
+		Client() : socket(-1) {}
+
+		~Client() { close(); }
+
+		Client(const Client&) = delete;
+
+		Client& operator=(const Client&) = delete;
+
+		bool connect(const std::string& path = server_socket());
+
+		void close();
+
+		bool load(const std::string& library, std::string* segment = nullptr);
+
+		bool lookup(const std::string& library, const std::string& name, Material& material);
+
+		bool batch(const std::string& library, const std::vector<std::string>& names, std::vector<Material>& materials);
+
+		bool attach(const std::string& library, Shared& shared);
+
+		bool stats(std::string& text);
+
+		const std::string& message() const { return error; }
+
+	private:
+
+		bool call(BinaryWriter& request, BinaryReader& reply);
+
+		int socket; // Connection to the server
+
+		std::string frame; // Last reply
+
+		std::string error; // Message of the last failed request
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline std::string server_socket()
+	{
+		const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+
+		return std::string(runtime && *runtime ? runtime : "/tmp") + "/mtld.sock";
+	}
+
+	inline bool send_frame(int socket, const std::string& frame)
+	{
+#if !defined(_WIN32)
+		if (frame.size() > SERVER_FRAME_LIMIT) return false;
+
+		std::string data;
+
+		const uint32_t length = static_cast<uint32_t>(frame.size());
+
+		data.reserve(sizeof length + frame.size());
+		data.append(reinterpret_cast<const char*>(&length), sizeof length);
+		data.append(frame);
+
+#ifdef MSG_NOSIGNAL
+		const int flags = MSG_NOSIGNAL;
+#else
+		const int flags = 0;
+#endif
+
+		for (size_t done = 0; done < data.size();)
+		{
+			const ssize_t count = ::send(socket, data.data() + done, data.size() - done, flags);
+
+			if (count < 0 && errno == EINTR) continue;
+
+			if (count <= 0) return false;
+
+			done += static_cast<size_t>(count);
+		}
+
+		return true;
+#else
+		(void)socket;
+		(void)frame;
+
+		return false;
+#endif
+	}
+
+	inline bool receive_frame(int socket, std::string& frame)
+	{
+#if !defined(_WIN32)
+		auto receive = [socket](char* data, size_t size)
+		{
+			for (size_t done = 0; done < size;)
+			{
+				const ssize_t count = ::recv(socket, data + done, size - done, 0);
+
+				if (count < 0 && errno == EINTR) continue;
+
+				if (count <= 0) return false;
+
+				done += static_cast<size_t>(count);
+			}
+
+			return true;
+		};
+
+		uint32_t length;
+
+		if (!receive(reinterpret_cast<char*>(&length), sizeof length) || length > SERVER_FRAME_LIMIT) return false;
+
+		frame.resize(length);
+
+		return receive(&frame[0], length);
+#else
+		(void)socket;
+		(void)frame;
+
+		return false;
+#endif
+	}
+
+	inline bool Client::connect(const std::string& path)
+	{
+		close();
+
+#if !defined(_WIN32)
+		sockaddr_un address = {};
+
+		address.sun_family = AF_UNIX;
+
+		if (path.size() >= sizeof address.sun_path)
+		{
+			error = "socket path too long";
+
+			return false;
+		}
+
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+		socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+		if (socket >= 0 && ::connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof address) == 0)
+			return true;
+
+		error = "cannot connect to " + path;
+
+		close();
+#else
+		(void)path;
+
+		error = "not available";
+#endif
+		return false;
+	}
+
+	inline void Client::close()
+	{
+#if !defined(_WIN32)
+		if (socket >= 0) ::close(socket);
+#endif
+		socket = -1;
+	}
+
+	inline bool Client::call(BinaryWriter& request, BinaryReader& reply)
+	{
+		if (socket < 0)
+		{
+			error = "not connected";
+
+			return false;
+		}
+
+		if (!send_frame(socket, request.str()) || !receive_frame(socket, frame))
+		{
+			error = "connection lost";
+
+			close();
+
+			return false;
+		}
+
+		reply = BinaryReader(frame.data(), frame.size());
+
+		uint8_t status;
+
+		if (reply.get(status) && status == 0) return true;
+
+		if (!reply.get(error)) error = "bad reply";
+
+		return false;
+	}
+
+	inline bool Client::load(const std::string& library, std::string* segment)
+	{
+		BinaryWriter request;
+
+		request.put(Request::load);
+		request.put(library);
+
+		BinaryReader reply(nullptr, 0);
+
+		std::string name;
+
+		if (!call(request, reply) || !reply.get(name)) return false;
+
+		if (segment) *segment = std::move(name);
+
+		return true;
+	}
+
+	inline bool Client::lookup(const std::string& library, const std::string& name, Material& material)
+	{
+		BinaryWriter request;
+
+		request.put(Request::lookup);
+		request.put(library);
+		request.put(name);
+
+		BinaryReader reply(nullptr, 0);
+
+		std::string_view record;
+
+		if (!call(request, reply) || !reply.get(record)) return false;
+
+		if (record.empty())
+		{
+			error = "material not found";
+
+			return false;
+		}
+
+		material = Material();
+
+		return from_binary(record.data(), record.size(), material);
+	}
+
+	inline bool Client::batch(const std::string& library, const std::vector<std::string>& names, std::vector<Material>& materials)
+	{
+		BinaryWriter request;
+
+		request.put(Request::batch);
+		request.put(library);
+		request.put(static_cast<uint32_t>(names.size()));
+
+		for (const auto& name : names)
+			request.put(name);
+
+		BinaryReader reply(nullptr, 0);
+
+		uint32_t count;
+
+		if (!call(request, reply) || !reply.get(count) || count != names.size()) return false;
+
+		materials.clear();
+
+		materials.resize(count);
+
+		std::string_view record;
+
+		for (auto& material : materials) // Materials not found are left unparsed
+			if (!reply.get(record) || (!record.empty() && !from_binary(record.data(), record.size(), material)))
+				return false;
+
+		return true;
+	}
+
+	inline bool Client::attach(const std::string& library, Shared& shared)
+	{
+		std::string segment;
+
+		return load(library, &segment) && shared.attach(segment);
+	}
+
+	inline bool Client::stats(std::string& text)
+	{
+		BinaryWriter request;
+
+		request.put(Request::stats);
+
+		BinaryReader reply(nullptr, 0);
+
+		return call(request, reply) && reply.get(text);
+	}
+}
@@ -0,0 +1,351 @@
+/*
+  DictionaryMTL.h
+
+  C++ code solution for prefix and glob search over Wavefront MTL material names
+
+  A Dictionary holds the material names of a library sorted and front coded:
+  names are grouped in blocks of 16, the first name of a block is stored in
+  full and every other name as the length of the prefix it shares with the
+  name before it followed by the rest. A query finds its first block with a
+  binary search over the block heads and then decodes forward, so a prefix
+  query costs O(log n + k) for k matches.
+
+	mtl::Dictionary names;
+	names.build(file);
+
+	std::vector<uint32_t> found;
+	names.prefix("brick_", found);     // Material index of every brick_ name
+	names.glob("veh_truck_*_d?", found);
+
+  Glob patterns know '*' (any run of characters) and '?' (any character).
+  The literal text before the first wildcard limits the names to test, so
+  patterns should start with a literal. Names compare byte by byte; a name
+  given to more than one material is kept once, at its first material, as
+  Load::lookup finds it. A name costs its unshared suffix, two length bytes
+  and a 4 byte material index, in place of a std::string per material.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "BinaryMTL.h"
+
+#include <string_view>
+
+namespace mtl
+{
+	class Dictionary
+	{
+	public:
+
+		using Name = std::pair<std::string_view, uint32_t>; // Name and material index
+
+		void build(Load& load);
+
+		void build(const Binary& binary);
+
+		void build(std::vector<Name> names);
+
+		size_t size() const { return ids.size(); }
+
+		size_t bytes() const { return text.capacity() + ids.capacity() * sizeof(uint32_t) + blocks.capacity() * sizeof(uint32_t); }
+
+		std::string name(size_t rank) const;
+
+		uint32_t material(size_t rank) const { return ids[rank]; }
+
+		size_t lower_bound(std::string_view key) const;
+
+		bool find(std::string_view key, uint32_t& material) const;
+
+		size_t prefix(std::string_view key, std::vector<uint32_t>& materials) const;
+
+		size_t glob(std::string_view pattern, std::vector<uint32_t>& materials) const;
+
+		static bool match(std::string_view pattern, std::string_view name);
+
+		static constexpr size_t BLOCK = 16; // Names per block
+
+	private:
+
+		void number(size_t value);
+
+		size_t number(size_t& at) const;
+
+		std::string_view head(size_t block) const;
+
+		template <typename Visit>
+		void scan(size_t rank, Visit visit) const;
+
+		std::string text; // Front coded names
+
+		std::vector<uint32_t> blocks; // Offset in text of each block
+
+		std::vector<uint32_t> ids; // Material index of each name, in sorted order
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline void Dictionary::number(size_t value)
+	{
+		while (value >= 0x80)
+		{
+			text.push_back(static_cast<char>(value | 0x80));
+
+			value >>= 7;
+		}
+
+		text.push_back(static_cast<char>(value));
+	}
+
+	inline size_t Dictionary::number(size_t& at) const
+	{
+		size_t value(0);
+
+		for (int shift = 0;; shift += 7)
+		{
+			const auto byte = static_cast<unsigned char>(text[at++]);
+
+			value |= static_cast<size_t>(byte & 0x7F) << shift;
+
+			if (byte < 0x80) return value;
+		}
+	}
+
+	inline std::string_view Dictionary::head(size_t block) const
+	{
+		size_t at = blocks[block];
+
+		const size_t length = number(at);
+
+		return std::string_view(text.data() + at, length);
+	}
+
+	template <typename Visit>
+	inline void Dictionary::scan(size_t rank, Visit visit) const
+	{
+		if (rank >= size()) return;
+
+		size_t block = rank / BLOCK;
+
+		size_t at = blocks[block];
+
+		std::string current;
+
+		for (size_t i = block * BLOCK; i < size(); i++)
+		{
+			if (i % BLOCK == 0)
+			{
+				at = blocks[i / BLOCK];
+
+				current.clear();
+			}
+
+			const size_t shared = i % BLOCK ? number(at) : 0;
+
+			const size_t rest = number(at);
+
+			current.resize(shared);
+			current.append(text.data() + at, rest);
+
+			at += rest;
+
+			if (i >= rank && !visit(std::string_view(current), i)) return;
+		}
+	}
+
+	inline void Dictionary::build(Load& load)
+	{
+		std::vector<Name> names;
+
+		names.reserve(load.materials().size());
+
+		uint32_t index(0);
+
+		for (const auto& material : load.materials())
+			if (material.name.isParsed())
+				names.emplace_back(material.name.value, index++);
+
+		build(std::move(names));
+	}
+
+	inline void Dictionary::build(const Binary& binary)
+	{
+		std::vector<Name> names(binary.size());
+
+		for (size_t i = 0; i < binary.size(); i++)
+			names[i] = Name(binary.name(i), static_cast<uint32_t>(i)); // Record index, as Binary::material takes it
+
+		build(std::move(names));
+	}
+
+	inline void Dictionary::build(std::vector<Name> names)
+	{
+		text.clear();
+		blocks.clear();
+		ids.clear();
+
+		std::sort(names.begin(), names.end());
+
+		names.erase(std::unique(names.begin(), names.end(), [](const Name& a, const Name& b) { return a.first == b.first; }), names.end());
+
+		ids.reserve(names.size());
+
+		blocks.reserve((names.size() + BLOCK - 1) / BLOCK);
+
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			const std::string_view name = names[i].first;
+
+			size_t shared(0);
+
+			if (i % BLOCK == 0)
+				blocks.push_back(static_cast<uint32_t>(text.size()));
+			else
+			{
+				const std::string_view before = names[i - 1].first;
+
+				while (shared < before.size() && shared < name.size() && before[shared] == name[shared])
+					shared++;
+
+				number(shared);
+			}
+
+			number(name.size() - shared);
+
+			text.append(name.data() + shared, name.size() - shared);
+
+			ids.push_back(names[i].second);
+		}
+
+		text.shrink_to_fit();
+	}
+
+	inline std::string Dictionary::name(size_t rank) const
+	{
+		std::string result;
+
+		scan(rank, [&](std::string_view name, size_t) { result = name; return false; });
+
+		return result;
+	}
+
+	inline size_t Dictionary::lower_bound(std::string_view key) const
+	{
+		size_t low(0), high(blocks.size());
+
+		while (low < high) // First block with a head greater than key
+		{
+			const size_t middle = (low + high) / 2;
+
+			if (key < head(middle))
+				high = middle;
+			else
+				low = middle + 1;
+		}
+
+		size_t rank = low ? (low - 1) * BLOCK : 0;
+
+		size_t found = std::min(low * BLOCK, size());
+
+		scan(rank, [&](std::string_view name, size_t i)
+		{
+			if (name < key) return i + 1 < low * BLOCK;
+
+			found = i;
+
+			return false;
+		});
+
+		return found;
+	}
+
+	inline bool Dictionary::find(std::string_view key, uint32_t& material) const
+	{
+		const size_t rank = lower_bound(key);
+
+		if (rank == size() || name(rank) != key) return false;
+
+		material = ids[rank];
+
+		return true;
+	}
+
+	inline size_t Dictionary::prefix(std::string_view key, std::vector<uint32_t>& materials) const
+	{
+		const size_t count = materials.size();
+
+		scan(lower_bound(key), [&](std::string_view name, size_t i)
+		{
+			if (name.substr(0, key.size()) != key) return false;
+
+			materials.push_back(ids[i]);
+
+			return true;
+		});
+
+		return materials.size() - count;
+	}
+
+	inline size_t Dictionary::glob(std::string_view pattern, std::vector<uint32_t>& materials) const
+	{
+		const size_t count = materials.size();
+
+		const std::string_view key = pattern.substr(0, std::min(pattern.find_first_of("*?"), pattern.size()));
+
+		scan(lower_bound(key), [&](std::string_view name, size_t i)
+		{
+			if (name.substr(0, key.size()) != key) return false;
+
+			if (match(pattern, name))
+				materials.push_back(ids[i]);
+
+			return true;
+		});
+
+		return materials.size() - count;
+	}
+
+	inline bool Dictionary::match(std::string_view pattern, std::string_view name)
+	{
+		size_t p(0), n(0);
+
+		size_t star = std::string_view::npos, mark(0); // Last '*' and the name position it resumes from
+
+		while (n < name.size())
+		{
+			if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]))
+			{
+				p++;
+				n++;
+			}
+			else if (p < pattern.size() && pattern[p] == '*')
+			{
+				star = p++;
+
+				mark = n;
+			}
+			else if (star != std::string_view::npos)
+			{
+				p = star + 1;
+
+				n = ++mark;
+			}
+			else
+				return false;
+		}
+
+		while (p < pattern.size() && pattern[p] == '*')
+			p++;
+
+		return p == pattern.size();
+	}
+}
@@ -0,0 +1,505 @@
+/*
+  GltfMTL.h
+
+  C++ code solution for exporting Wavefront MTL materials to glTF 2.0
+
+  Writes the materials, textures, images and samplers arrays of a glTF 2.0
+  document for all materials of a Load. Images, samplers and textures are
+  shared between materials. The result is a JSON object with these arrays and
+  extensionsUsed, to be merged into the glTF document of the geometry.
+
+	Kd, d/Tr, map_Kd     -> pbrMetallicRoughness baseColorFactor/Texture (linear)
+	Pm, Pr, map_ORM      -> pbrMetallicRoughness metallic/roughness (G/B of ORM)
+	map_ORM, map_Po      -> occlusionTexture
+	norm, map_bump, bump -> normalTexture (-bm is the scale)
+	Ke, map_Ke           -> emissiveFactor/Texture (linear), KHR_materials_emissive_strength
+	Ps, map_Ps           -> KHR_materials_sheen
+	Pc, Pcr              -> KHR_materials_clearcoat
+	aniso, anisor        -> KHR_materials_anisotropy (anisor in turns)
+	Ni                   -> KHR_materials_ior
+	-o, -s               -> KHR_texture_transform
+	-clamp               -> sampler wrap mode
+	-blendu, -blendv     -> sampler filter, nearest when both are off
+
+  glTF factors are linear; colors still in sRGB (rgb::encoding, a Load that
+  was not linearized) are converted with srgb_to_linear as they are written.
+  map_RMA, map_Pr and map_Pm have no direct glTF counterpart (channel layout
+  differs) and are not exported.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "JsonMTL.h"
+#include "SamplerMTL.h"
+
+#include <map>
+#include <set>
+#include <unordered_map>
+
+namespace mtl
+{
+	class Gltf
+	{
+	public:
+
+		explicit Gltf(JsonWriter& out) : out(out) {}
+
+		void write(Load& load);
+
+	private:
+
+		void material(const Material& material);
+
+		int texture(const Texture& texture);
+
+		void info(const char* name, const Texture& texture, const char* scale = nullptr, double value = 1);
+
+		static std::string uri(const std::string& file);
+
+		static rgb linear(const rgb& color);
+
+		JsonWriter& out;
+
+		std::unordered_map<std::string, int> images; // Image index by file
+
+		std::vector<const std::string*> files; // Image files in index order
+
+		Samplers samplers; // Unique sampler states, swizzle is not part of a glTF sampler
+
+		std::map<std::pair<int, int>, int> textures; // Texture index by image and sampler
+
+		std::vector<std::pair<int, int>> sources; // Image and sampler of each texture
+
+		std::set<std::string> extensions; // Extensions used
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline std::string Gltf::uri(const std::string& file)
+	{
+		static const char* hex = "0123456789ABCDEF";
+
+		std::string text;
+
+		text.reserve(file.size());
+
+		for (const char c : file)
+		{
+			const auto u = static_cast<unsigned char>(c);
+
+			if (c == '\\')
+				text += '/';
+			else if (std::isalnum(u) || std::strchr("-._~/:", c))
+				text += c;
+			else
+			{
+				text += '%';
+				text += hex[u >> 4];
+				text += hex[u & 15];
+			}
+		}
+
+		return text;
+	}
+
+	inline rgb Gltf::linear(const rgb& color)
+	{
+		if (color.encoding == Encoding::linear) return color;
+
+		return rgb(srgb_to_linear(color.r), srgb_to_linear(color.g), srgb_to_linear(color.b), Encoding::linear);
+	}
+
+	inline int Gltf::texture(const Texture& texture)
+	{
+		auto image = images.find(texture.file.value);
+
+		if (image == images.end())
+		{
+			image = images.emplace(texture.file.value, static_cast<int>(files.size())).first;
+
+			files.push_back(&image->first);
+		}
+
+		Sampler state = sampler(texture);
+
+		if (state.u != state.v) state.u = state.v = Filter::linear; // glTF filters both axes alike
+
+		const auto key = std::make_pair(image->second, static_cast<int>(samplers.add(state)));
+
+		auto found = textures.find(key);
+
+		if (found != textures.end())
+			return found->second;
+
+		sources.push_back(key);
+
+		return textures[key] = static_cast<int>(sources.size() - 1);
+	}
+
+	inline void Gltf::info(const char* name, const Texture& item, const char* scale, double value)
+	{
+		out.key(name);
+		out.open('{');
+		out.key("index");
+		out.number(texture(item));
+
+		if (scale)
+		{
+			out.key(scale);
+			out.number(value);
+		}
+
+		if (item.o.isParsed() || item.s.isParsed())
+		{
+			extensions.insert("KHR_texture_transform");
+
+			out.key("extensions");
+			out.open('{');
+			out.key("KHR_texture_transform");
+			out.open('{');
+
+			if (item.o.isParsed())
+			{
+				const double offset[] = { item.o.u, item.o.v };
+
+				out.key("offset");
+				out.numbers(offset, 2);
+			}
+
+			if (item.s.isParsed())
+			{
+				const double size[] = { item.s.u, item.s.v };
+
+				out.key("scale");
+				out.numbers(size, 2);
+			}
+
+			out.close('}');
+			out.close('}');
+		}
+
+		out.close('}');
+	}
+
+	inline void Gltf::material(const Material& m)
+	{
+		auto has = [](const Texture& t) { return t.isParsed() && t.file.isParsed() && !t.file.value.empty(); };
+
+		out.open('{');
+
+		if (m.name.isParsed())
+		{
+			out.key("name");
+			out.string(m.name.value);
+		}
+
+		double alpha(1);
+
+		if (m.d.isParsed())
+			alpha = m.d.d;
+		else if (m.Tr.isParsed())
+			alpha = 1 - m.Tr.value;
+
+		out.key("pbrMetallicRoughness");
+		out.open('{');
+
+		if (m.Kd.color.isParsed() || alpha < 1)
+		{
+			const rgb Kd = m.Kd.color.isParsed() ? linear(m.Kd.color) : rgb(1, 1, 1, Encoding::linear);
+
+			const double color[] = { Kd.r, Kd.g, Kd.b, alpha };
+
+			out.key("baseColorFactor");
+			out.numbers(color, 4);
+		}
+
+		if (has(m.map_Kd))
+			info("baseColorTexture", m.map_Kd);
+
+		if (m.Pm.isParsed())
+		{
+			out.key("metallicFactor");
+			out.number(m.Pm.value);
+		}
+
+		if (m.Pr.isParsed())
+		{
+			out.key("roughnessFactor");
+			out.number(m.Pr.value);
+		}
+
+		if (has(m.map_ORM))
+			info("metallicRoughnessTexture", m.map_ORM);
+
+		out.close('}');
+
+		if (has(m.norm))
+			info("normalTexture", m.norm, "scale", m.norm.bm.isParsed() ? m.norm.bm.value : 1);
+		else if (has(m.map_bump))
+			info("normalTexture", m.map_bump, "scale", m.map_bump.bm.isParsed() ? m.map_bump.bm.value : 1);
+		else if (has(m.bump))
+			info("normalTexture", m.bump, "scale", m.bump.bm.isParsed() ? m.bump.bm.value : 1);
+
+		if (has(m.map_ORM))
+			info("occlusionTexture", m.map_ORM);
+		else if (has(m.map_Po))
+			info("occlusionTexture", m.map_Po);
+
+		double strength(1);
+
+		if (m.Ke.color.isParsed())
+		{
+			const rgb Ke = linear(m.Ke.color);
+
+			strength = std::max(std::max(Ke.r, Ke.g), std::max(Ke.b, 1.0));
+
+			const double color[] = { Ke.r / strength, Ke.g / strength, Ke.b / strength };
+
+			out.key("emissiveFactor");
+			out.numbers(color, 3);
+		}
+		else if (has(m.map_Ke))
+		{
+			const double color[] = { 1, 1, 1 };
+
+			out.key("emissiveFactor");
+			out.numbers(color, 3);
+		}
+
+		if (has(m.map_Ke))
+			info("emissiveTexture", m.map_Ke);
+
+		if (alpha < 1 || has(m.map_d))
+		{
+			out.key("alphaMode");
+			out.string("BLEND");
+		}
+
+		const bool sheen = m.Ps.isParsed() || has(m.map_Ps);
+		const bool clearcoat = m.Pc.isParsed() || m.Pcr.isParsed();
+		const bool anisotropy = m.aniso.isParsed() || m.anisor.isParsed();
+		const bool ior = m.Ni.isParsed() && m.Ni.value >= 1;
+
+		if (sheen || clearcoat || anisotropy || ior || strength > 1)
+		{
+			out.key("extensions");
+			out.open('{');
+
+			if (sheen)
+			{
+				extensions.insert("KHR_materials_sheen");
+
+				out.key("KHR_materials_sheen");
+				out.open('{');
+
+				if (m.Ps.isParsed())
+				{
+					const double color[] = { m.Ps.value, m.Ps.value, m.Ps.value };
+
+					out.key("sheenColorFactor");
+					out.numbers(color, 3);
+				}
+
+				if (has(m.map_Ps))
+					info("sheenColorTexture", m.map_Ps);
+
+				out.close('}');
+			}
+
+			if (clearcoat)
+			{
+				extensions.insert("KHR_materials_clearcoat");
+
+				out.key("KHR_materials_clearcoat");
+				out.open('{');
+
+				if (m.Pc.isParsed())
+				{
+					out.key("clearcoatFactor");
+					out.number(m.Pc.value);
+				}
+
+				if (m.Pcr.isParsed())
+				{
+					out.key("clearcoatRoughnessFactor");
+					out.number(m.Pcr.value);
+				}
+
+				out.close('}');
+			}
+
+			if (anisotropy)
+			{
+				extensions.insert("KHR_materials_anisotropy");
+
+				out.key("KHR_materials_anisotropy");
+				out.open('{');
+
+				if (m.aniso.isParsed())
+				{
+					out.key("anisotropyStrength");
+					out.number(m.aniso.value);
+				}
+
+				if (m.anisor.isParsed())
+				{
+					out.key("anisotropyRotation");
+					out.number(m.anisor.value * 6.283185307179586);
+				}
+
+				out.close('}');
+			}
+
+			if (ior)
+			{
+				extensions.insert("KHR_materials_ior");
+
+				out.key("KHR_materials_ior");
+				out.open('{');
+				out.key("ior");
+				out.number(m.Ni.value);
+				out.close('}');
+			}
+
+			if (strength > 1)
+			{
+				extensions.insert("KHR_materials_emissive_strength");
+
+				out.key("KHR_materials_emissive_strength");
+				out.open('{');
+				out.key("emissiveStrength");
+				out.number(strength);
+				out.close('}');
+			}
+
+			out.close('}');
+		}
+
+		out.close('}');
+	}
+
+	inline void Gltf::write(Load& load)
+	{
+		out.open('{');
+
+		// glTF requires at least one item in each top level array, so empty ones are left out
+
+		const auto named = [](const Material& item) { return item.name.isParsed(); };
+
+		if (std::any_of(load.materials().begin(), load.materials().end(), named))
+		{
+			out.key("materials");
+			out.open('[');
+
+			for (const auto& item : load.materials())
+			{
+				if (item.name.isParsed())
+					material(item);
+
+				out.flush();
+			}
+
+			out.close(']');
+		}
+
+		if (!sources.empty()) // Images and samplers are only referenced by textures
+		{
+			out.key("textures");
+			out.open('[');
+
+			for (const auto& source : sources)
+			{
+				out.open('{');
+				out.key("source");
+				out.number(source.first);
+				out.key("sampler");
+				out.number(source.second);
+				out.close('}');
+			}
+
+			out.close(']');
+
+			out.key("images");
+			out.open('[');
+
+			for (const auto* file : files)
+			{
+				out.open('{');
+				out.key("uri");
+				out.string(uri(*file));
+				out.close('}');
+
+				out.flush();
+			}
+
+			out.close(']');
+
+			out.key("samplers");
+			out.open('[');
+
+			for (const Sampler& state : samplers.table)
+			{
+				const bool nearest = state.u == Filter::nearest;
+
+				const int wrap = state.wrap == Wrap::clamp ? 33071 : 10497; // CLAMP_TO_EDGE, REPEAT
+
+				out.open('{');
+				out.key("magFilter");
+				out.number(nearest ? 9728 : 9729); // NEAREST, LINEAR
+				out.key("minFilter");
+				out.number(nearest ? 9984 : 9987); // NEAREST_MIPMAP_NEAREST, LINEAR_MIPMAP_LINEAR
+				out.key("wrapS");
+				out.number(wrap);
+				out.key("wrapT");
+				out.number(wrap);
+				out.close('}');
+			}
+
+			out.close(']');
+		}
+
+		if (!extensions.empty())
+		{
+			out.key("extensionsUsed");
+			out.open('[');
+
+			for (const auto& extension : extensions)
+				out.string(extension);
+
+			out.close(']');
+		}
+
+		out.close('}');
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline std::string to_gltf(Load& load)
+	{
+		JsonWriter out;
+
+		Gltf(out).write(load);
+
+		return std::move(out.str());
+	}
+
+	inline bool to_gltf(Load& load, FILE* stream)
+	{
+		if (!stream) return false;
+
+		JsonWriter out(stream);
+
+		Gltf(out).write(load);
+
+		return out.flush();
+	}
+}
@@ -0,0 +1,405 @@
+/*
+  HashMTL.h
+
+  C++ code solution for finding identical texture files of Wavefront MTL libraries
+
+  Materials often reference byte identical images under different paths,
+  copies in other folders or renamed exports, which interning the paths can
+  not find. TextureHashes hashes the contents of every unique texture file in
+  parallel, memory mapped, with a built-in 64 bit hash in the style of
+  xxHash64, and merge() joins the textures of a Pack (PackMTL.h) with equal
+  contents into one entry of the texture table.
+
+	mtl::TextureHashes hashes;
+	hashes.load("textures.cache");           // Optional
+	hashes.hash(file, "/assets/scene");      // Folder the texture paths are relative to
+	hashes.save("textures.cache");
+
+	mtl::Pack pack;
+	pack.build(file);
+	mtl::merge(pack, hashes, "/assets/scene"); // Returns the number of textures merged
+
+  Results are kept by path, size and modification time; a file that has not
+  changed since the cache was saved is not read again. Files that can not be
+  read are not merged. Equal hash and size count as equal contents, the files
+  are not compared byte by byte.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "PackMTL.h"
+
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace mtl
+{
+	struct ContentHash
+	{
+		uint64_t size; // File size in bytes
+		int64_t  time; // Modification time, file clock ticks
+		uint64_t hash; // Hash of the contents
+	};
+
+	uint64_t content_hash(const char* data, size_t size, uint64_t seed = 0);
+
+	class TextureHashes
+	{
+	public:
+
+		size_t hash(const std::vector<std::string>& files, size_t threads = 0);
+
+		size_t hash(Load& load, const std::string& directory = "", size_t threads = 0);
+
+		bool find(const std::string& file, ContentHash& entry) const;
+
+		size_t size() const { return entries.size(); }
+
+		bool load(const std::string& path);
+
+		bool save(const std::string& path) const;
+
+		static std::string resolve(const std::string& directory, const std::string& file);
+
+	private:
+
+		static bool stat(const std::string& file, ContentHash& entry);
+
+		static bool read(const std::string& file, ContentHash& entry);
+
+		std::unordered_map<std::string, ContentHash> entries; // By path
+	};
+
+	size_t merge(Pack& pack, const TextureHashes& hashes, const std::string& directory = "");
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline uint64_t content_hash(const char* data, size_t size, uint64_t seed)
+	{
+		constexpr uint64_t P1 = 0x9E3779B185EBCA87ull, P2 = 0xC2B2AE3D27D4EB4Full, P3 = 0x165667B19E3779F9ull;
+
+		auto rotate = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+
+		auto round = [&](uint64_t lane, uint64_t word) { return rotate(lane + word * P2, 31) * P1; };
+
+		auto word = [](const char* p) { uint64_t v; std::memcpy(&v, p, sizeof v); return v; };
+
+		const char* p = data;
+
+		const char* end = data + size;
+
+		uint64_t h;
+
+		if (size >= 32)
+		{
+			uint64_t lane[4] = { seed + P1 + P2, seed + P2, seed, seed - P1 };
+
+			for (; end - p >= 32; p += 32)
+				for (int i = 0; i < 4; i++)
+					lane[i] = round(lane[i], word(p + i * 8));
+
+			h = rotate(lane[0], 1) + rotate(lane[1], 7) + rotate(lane[2], 12) + rotate(lane[3], 18);
+
+			for (const uint64_t item : lane)
+				h = (h ^ round(0, item)) * P1 + P3;
+		}
+		else
+			h = seed + P3;
+
+		h += size;
+
+		for (; end - p >= 8; p += 8)
+			h = rotate(h ^ round(0, word(p)), 27) * P1 + P2;
+
+		for (; p < end; p++)
+			h = rotate(h ^ (static_cast<unsigned char>(*p) * P3), 11) * P1;
+
+		h ^= h >> 33;
+		h *= P2;
+		h ^= h >> 29;
+		h *= P3;
+
+		return h ^ (h >> 32);
+	}
+
+	inline std::string TextureHashes::resolve(const std::string& directory, const std::string& file)
+	{
+		std::string path = file;
+
+		std::replace(path.begin(), path.end(), '\\', '/');
+
+		if (directory.empty() || std::filesystem::path(path).is_absolute()) return path;
+
+		return (std::filesystem::path(directory) / path).lexically_normal().string();
+	}
+
+	inline bool TextureHashes::stat(const std::string& file, ContentHash& entry)
+	{
+		std::error_code error;
+
+		entry.size = std::filesystem::file_size(file, error);
+
+		if (error) return false;
+
+		entry.time = static_cast<int64_t>(std::filesystem::last_write_time(file, error).time_since_epoch().count());
+
+		return !error;
+	}
+
+	inline bool TextureHashes::read(const std::string& file, ContentHash& entry)
+	{
+		if (!stat(file, entry)) return false;
+
+#if !defined(_WIN32)
+		const int fd = ::open(file.c_str(), O_RDONLY);
+
+		if (fd < 0) return false;
+
+		struct ::stat st;
+
+		bool done(false);
+
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+		{
+			void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (map != MAP_FAILED)
+			{
+				madvise(map, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+				entry.size = static_cast<uint64_t>(st.st_size);
+
+				entry.hash = content_hash(static_cast<const char*>(map), entry.size);
+
+				munmap(map, entry.size);
+
+				done = true;
+			}
+		}
+
+		::close(fd);
+
+		if (done) return true;
+#endif
+
+		FILE* stream = fopen(file.c_str(), "rb");
+
+		if (!stream) return false;
+
+		std::string data;
+
+		char block[65536];
+
+		size_t count;
+
+		while ((count = fread(block, 1, sizeof block, stream)) != 0)
+			data.append(block, count);
+
+		fclose(stream);
+
+		entry.size = data.size();
+
+		entry.hash = content_hash(data.data(), data.size());
+
+		return true;
+	}
+
+	inline size_t TextureHashes::hash(const std::vector<std::string>& files, size_t threads)
+	{
+		std::vector<std::string> unique(files);
+
+		std::sort(unique.begin(), unique.end());
+
+		unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+		std::vector<ContentHash> results(unique.size());
+
+		std::vector<uint8_t> state(unique.size()); // 0 failed, 1 cached, 2 hashed
+
+		std::atomic<size_t> next(0);
+
+		auto work = [&]()
+		{
+			for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < unique.size();)
+			{
+				const auto found = entries.find(unique[i]);
+
+				ContentHash current;
+
+				if (found != entries.end() && stat(unique[i], current) && current.size == found->second.size && current.time == found->second.time)
+				{
+					results[i] = found->second;
+
+					state[i] = 1;
+				}
+				else if (read(unique[i], results[i]))
+					state[i] = 2;
+			}
+		};
+
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+
+		std::vector<std::thread> workers;
+
+		for (size_t t = 1; t < std::min(threads, unique.size()); t++)
+			workers.emplace_back(work);
+
+		work();
+
+		for (auto& worker : workers)
+			worker.join();
+
+		size_t hashed(0);
+
+		for (size_t i = 0; i < unique.size(); i++)
+		{
+			if (state[i])
+				entries[unique[i]] = results[i];
+			else
+				entries.erase(unique[i]);
+
+			hashed += state[i] == 2;
+		}
+
+		return hashed;
+	}
+
+	inline size_t TextureHashes::hash(Load& load, const std::string& directory, size_t threads)
+	{
+		std::vector<std::string> files;
+
+		const auto add = [&](const char*, const Texture& item) { if (item.isParsed() && item.file.isParsed()) files.push_back(resolve(directory, item.file.value)); };
+
+		for (const auto& material : load.materials())
+		{
+			visit(material, [&](const char* keyword, const auto& item)
+			{
+				using T = std::decay_t<decltype(item)>;
+
+				if constexpr (std::is_same_v<T, Texture>)
+					add(keyword, item);
+				else if constexpr (std::is_same_v<T, Reflection>)
+					visit_reflection(item, add);
+			});
+
+			for (const auto& item : material.custom)
+				if (item.isParsed() && item.type == Statement::texture)
+					add(item.keyword.c_str(), item.texture);
+		}
+
+		return hash(files, threads);
+	}
+
+	inline bool TextureHashes::find(const std::string& file, ContentHash& entry) const
+	{
+		const auto found = entries.find(file);
+
+		if (found == entries.end()) return false;
+
+		entry = found->second;
+
+		return true;
+	}
+
+	// Cache file: "MTLH", version, count, then path, size, time and hash of each file
+
+	inline bool TextureHashes::load(const std::string& path)
+	{
+		FILE* stream = fopen(path.c_str(), "rb");
+
+		if (!stream) return false;
+
+		std::string data;
+
+		char block[65536];
+
+		size_t count;
+
+		while ((count = fread(block, 1, sizeof block, stream)) != 0)
+			data.append(block, count);
+
+		fclose(stream);
+
+		BinaryReader in(data.data(), data.size());
+
+		char magic[4];
+
+		uint32_t version, total;
+
+		if (!in.get(magic) || std::memcmp(magic, "MTLH", 4) != 0 || !in.get(version) || version != 1 || !in.get(total)) return false;
+
+		std::string file;
+
+		for (uint32_t i = 0; i < total; i++)
+		{
+			ContentHash entry;
+
+			if (!in.get(file) || !in.get(entry.size) || !in.get(entry.time) || !in.get(entry.hash)) return false;
+
+			entries[file] = entry;
+		}
+
+		return true;
+	}
+
+	inline bool TextureHashes::save(const std::string& path) const
+	{
+		BinaryWriter out;
+
+		out.put("MTLH", 4);
+		out.put(static_cast<uint32_t>(1));
+		out.put(static_cast<uint32_t>(entries.size()));
+
+		for (const auto& item : entries)
+		{
+			out.put(item.first);
+			out.put(item.second.size);
+			out.put(item.second.time);
+			out.put(item.second.hash);
+		}
+
+		FILE* stream = fopen(path.c_str(), "wb");
+
+		if (!stream) return false;
+
+		const bool good = fwrite(out.str().data(), 1, out.size(), stream) == out.size();
+
+		return fclose(stream) == 0 && good;
+	}
+
+	inline size_t merge(Pack& pack, const TextureHashes& hashes, const std::string& directory)
+	{
+		std::vector<uint64_t> keys(pack.textures.size());
+
+		std::map<std::pair<uint64_t, uint64_t>, uint64_t> groups; // Key of each (hash, size), from 1, 0 is unknown
+
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			ContentHash entry;
+
+			if (hashes.find(TextureHashes::resolve(directory, pack.textures[i]), entry))
+				keys[i] = groups.emplace(std::make_pair(entry.hash, entry.size), groups.size() + 1).first->second;
+		}
+
+		return pack.deduplicate(keys);
+	}
+}
@@ -0,0 +1,995 @@
+/*
+  JsonMTL.h
+
+  C++ code solution for writing and reading Wavefront MTL data as JSON
+
+  Only values that are parsed (see isParsed) are written. The writer works in
+  a single buffer that is either returned as a string or flushed to a FILE*
+  while writing. Numbers are written with std::to_chars (shortest round trip);
+  JSON has no inf or nan, so non-finite numbers are written as null and read
+  back as NaN. The reader gives up on input nested deeper than JSON_DEPTH.
+  Colors converted by Load::linearize are written with "linear": true.
+
+	{
+	  "information": [ "comment", ... ],
+	  "materials": [
+	    {
+	      "name": "advance",
+	      "Kd": { "rgb": [ 1, 0.5, 0.25 ] },
+	      "Ns": 10,
+	      "d": { "d": 0.66, "halo": true },
+	      "map_Kd": { "file": "chrome.mpc", "blendu": false, "o": [ 0, 0, 0 ] },
+	      "refl": { "sphere": { "file": "clouds.mpc" } },
+	      "custom": { "x_shader": { "string": "pbr_metal" } }
+	    }
+	  ]
+	}
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "WavefrontMTL.h"
+
+#include <limits>
+#include <string_view>
+
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+
+namespace mtl
+{
+	constexpr size_t JSON_DEPTH = 64; // Deepest nesting of objects and arrays read
+
+	class JsonWriter
+	{
+	public:
+
+		explicit JsonWriter(FILE* sink = nullptr) : sink(sink), comma(false), good(true) { buffer.reserve(1 << 16); }
+
+		std::string& str() { return buffer; }
+
+		bool flush();
+
+		void open(char c) { element(); buffer += c; comma = false; }
+
+		void close(char c) { buffer += c; comma = true; }
+
+		void key(const char* name);
+
+		void element() { if (comma) buffer += ','; comma = false; }
+
+		void string(const std::string& text);
+
+		void number(double value);
+
+		void number(int value);
+
+		void boolean(bool value) { element(); buffer += value ? "true" : "false"; comma = true; }
+
+		void numbers(const double* values, size_t count);
+
+	private:
+
+		void escape(const char* text, size_t length);
+
+		FILE* sink; // Flush target (optional)
+
+		bool comma; // Next value needs a separator
+
+		bool good; // All flushes succeeded
+
+		std::string buffer;
+	};
+
+	class JsonReader
+	{
+	public:
+
+		JsonReader(const char* data, size_t size) : p(data), end(data + size), depth(0) {}
+
+		bool eat(char c);
+
+		bool string(std::string& text);
+
+		bool number(double& value);
+
+		bool boolean(bool& value);
+
+		bool numbers(double* values, size_t count);
+
+		bool skip();
+
+		bool done() { space(); return p == end; }
+
+		template <typename Member>
+		bool object(Member&& member);
+
+		template <typename Element>
+		bool array(Element&& element);
+
+	private:
+
+		void space() { while (p < end && std::isspace(*p)) p++; }
+
+		const char* p;
+
+		const char* end;
+
+		size_t depth; // Objects and arrays open
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline bool JsonWriter::flush()
+	{
+		if (!sink) return good;
+
+		if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), sink) != buffer.size())
+			good = false;
+
+		buffer.clear();
+
+		return good;
+	}
+
+	inline void JsonWriter::key(const char* name)
+	{
+		if (comma) buffer += ',';
+
+		escape(name, std::strlen(name));
+
+		buffer += ':';
+
+		comma = false;
+
+		if (sink && buffer.size() > (1 << 16) - 1024)
+			flush();
+	}
+
+	inline void JsonWriter::string(const std::string& text)
+	{
+		element();
+
+		escape(text.data(), text.size());
+
+		comma = true;
+	}
+
+	inline void JsonWriter::escape(const char* text, size_t length)
+	{
+		buffer += '"';
+
+		for (const char c : std::string_view(text, length))
+		{
+			switch (c)
+			{
+			case '"': buffer += "\\\""; break;
+			case '\\': buffer += "\\\\"; break;
+			case '\n': buffer += "\\n"; break;
+			case '\r': buffer += "\\r"; break;
+			case '\t': buffer += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char code[8];
+
+					snprintf(code, sizeof code, "\\u%04x", c);
+
+					buffer += code;
+				}
+				else
+					buffer += c;
+			}
+		}
+
+		buffer += '"';
+	}
+
+	inline void JsonWriter::number(double value)
+	{
+		element();
+
+		if (!std::isfinite(value))
+		{
+			buffer += "null";
+
+			comma = true;
+
+			return;
+		}
+
+		char text[32];
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+		const auto result = std::to_chars(text, text + sizeof text, value);
+
+		buffer.append(text, result.ptr);
+#else
+		buffer.append(text, snprintf(text, sizeof text, "%.17g", value));
+#endif
+		comma = true;
+	}
+
+	inline void JsonWriter::number(int value)
+	{
+		element();
+
+		char text[16];
+
+		buffer.append(text, snprintf(text, sizeof text, "%d", value));
+
+		comma = true;
+	}
+
+	inline void JsonWriter::numbers(const double* values, size_t count)
+	{
+		open('[');
+
+		for (size_t i = 0; i < count; i++)
+			number(values[i]);
+
+		close(']');
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline bool JsonReader::eat(char c)
+	{
+		space();
+
+		if (p == end || *p != c) return false;
+
+		p++;
+
+		return true;
+	}
+
+	inline bool JsonReader::string(std::string& text)
+	{
+		if (!eat('"')) return false;
+
+		text.clear();
+
+		auto hex = [&](unsigned long& code) // Four hex digits of a \u escape
+		{
+			if (end - p < 4) return false;
+
+			code = 0;
+
+			for (const char* last = p + 4; p < last; p++)
+			{
+				const char c = *p;
+
+				if (c >= '0' && c <= '9') code = code * 16 + (c - '0');
+				else if (c >= 'a' && c <= 'f') code = code * 16 + (c - 'a' + 10);
+				else if (c >= 'A' && c <= 'F') code = code * 16 + (c - 'A' + 10);
+				else return false;
+			}
+
+			return true;
+		};
+
+		while (p < end && *p != '"')
+		{
+			if (*p != '\\')
+			{
+				const char* run = p;
+
+				while (p < end && *p != '"' && *p != '\\') p++;
+
+				text.append(run, p);
+
+				continue;
+			}
+
+			if (++p == end) return false;
+
+			switch (*p++)
+			{
+			case 'n': text += '\n'; break;
+			case 'r': text += '\r'; break;
+			case 't': text += '\t'; break;
+			case 'b': text += '\b'; break;
+			case 'f': text += '\f'; break;
+			case 'u':
+			{
+				unsigned long code, low;
+
+				if (!hex(code) || (code >= 0xDC00 && code <= 0xDFFF)) return false; // Low surrogate without a high one
+
+				if (code >= 0xD800 && code <= 0xDBFF) // High surrogate, the low one follows as \uDC00 to \uDFFF
+				{
+					if (end - p < 2 || p[0] != '\\' || p[1] != 'u') return false;
+
+					p += 2;
+
+					if (!hex(low) || low < 0xDC00 || low > 0xDFFF) return false;
+
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+
+				if (code < 0x80)
+					text += static_cast<char>(code);
+				else if (code < 0x800)
+				{
+					text += static_cast<char>(0xC0 | (code >> 6));
+					text += static_cast<char>(0x80 | (code & 0x3F));
+				}
+				else if (code < 0x10000)
+				{
+					text += static_cast<char>(0xE0 | (code >> 12));
+					text += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+					text += static_cast<char>(0x80 | (code & 0x3F));
+				}
+				else
+				{
+					text += static_cast<char>(0xF0 | (code >> 18));
+					text += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+					text += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+					text += static_cast<char>(0x80 | (code & 0x3F));
+				}
+
+				break;
+			}
+			default: text += p[-1];
+			}
+		}
+
+		return eat('"');
+	}
+
+	inline bool JsonReader::number(double& value)
+	{
+		space();
+
+		if (end - p >= 4 && std::memcmp(p, "null", 4) == 0) // Written for inf and nan
+		{
+			p += 4;
+
+			value = std::numeric_limits<double>::quiet_NaN();
+
+			return true;
+		}
+
+		char text[64];
+
+		size_t n(0);
+
+		while (p + n < end && n < sizeof text - 1 && p[n] != '\0' && std::strchr("+-.0123456789eE", p[n]))
+		{
+			text[n] = p[n];
+			n++;
+		}
+
+		text[n] = '\0';
+
+		char* stop = nullptr;
+
+		value = std::strtod(text, &stop);
+
+		if (stop == text) return false;
+
+		p += stop - text;
+
+		return true;
+	}
+
+	inline bool JsonReader::boolean(bool& value)
+	{
+		space();
+
+		if (end - p >= 4 && std::memcmp(p, "true", 4) == 0)
+		{
+			p += 4;
+
+			return value = true;
+		}
+
+		if (end - p >= 5 && std::memcmp(p, "false", 5) == 0)
+		{
+			p += 5;
+
+			value = false;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	inline bool JsonReader::numbers(double* values, size_t count)
+	{
+		size_t n(0);
+
+		return array([&]() { return n < count && number(values[n++]); }) && n == count;
+	}
+
+	template <typename Member>
+	bool JsonReader::object(Member&& member)
+	{
+		if (depth == JSON_DEPTH || !eat('{')) return false;
+
+		if (eat('}')) return true;
+
+		std::string name;
+
+		bool good;
+
+		depth++;
+
+		do good = string(name) && eat(':') && member(name);
+		while (good && eat(','));
+
+		depth--;
+
+		return good && eat('}');
+	}
+
+	template <typename Element>
+	bool JsonReader::array(Element&& element)
+	{
+		if (depth == JSON_DEPTH || !eat('[')) return false;
+
+		if (eat(']')) return true;
+
+		bool good;
+
+		depth++;
+
+		do good = element();
+		while (good && eat(','));
+
+		depth--;
+
+		return good && eat(']');
+	}
+
+	inline bool JsonReader::skip()
+	{
+		space();
+
+		if (p == end) return false;
+
+		if (*p == '{')
+			return object([&](const std::string&) { return skip(); });
+
+		if (*p == '[')
+			return array([&]() { return skip(); });
+
+		if (*p == '"')
+		{
+			std::string text;
+
+			return string(text);
+		}
+
+		if (*p == 'n' && end - p >= 4 && std::memcmp(p, "null", 4) == 0)
+		{
+			p += 4;
+
+			return true;
+		}
+
+		bool b;
+
+		if (*p == 't' || *p == 'f')
+			return boolean(b);
+
+		double d;
+
+		return number(d);
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	struct JsonFields
+	{
+		JsonWriter& out;
+
+		void operator()(const char* name, const Value<double>& item) { if (item.isParsed()) { out.key(name); out.number(item.value); } }
+
+		void operator()(const char* name, const Value<int>& item) { if (item.isParsed()) { out.key(name); out.number(item.value); } }
+
+		void operator()(const char* name, const Value<bool>& item) { if (item.isParsed()) { out.key(name); out.boolean(item.value); } }
+
+		void operator()(const char* name, const Value<char>& item) { if (item.isParsed()) { out.key(name); out.string(std::string(1, item.value)); } }
+
+		void operator()(const char* name, const Value<std::string>& item) { if (item.isParsed()) { out.key(name); out.string(item.value); } }
+
+		void operator()(const char* name, const Model& item)
+		{
+			if (!item.isParsed()) return;
+
+			const double values[] = { static_cast<double>(item.base), static_cast<double>(item.gain) };
+
+			out.key(name);
+			out.numbers(values, 2);
+		}
+
+		void operator()(const char* name, const uvw& item)
+		{
+			if (!item.isParsed()) return;
+
+			const double values[] = { item.u, item.v, item.w };
+
+			out.key(name);
+			out.numbers(values, 3);
+		}
+
+		void operator()(const char* name, const Color& item)
+		{
+			if (!item.isParsed()) return;
+
+			out.key(name);
+			out.open('{');
+
+			if (item.color.isParsed())
+			{
+				const double values[] = { item.color.r, item.color.g, item.color.b };
+
+				out.key("rgb");
+				out.numbers(values, 3);
+
+				if (item.color.encoding == Encoding::linear)
+				{
+					out.key("linear");
+					out.boolean(true);
+				}
+			}
+
+			if (item.color_space.isParsed())
+			{
+				const double values[] = { item.color_space.x, item.color_space.y, item.color_space.z };
+
+				out.key("xyz");
+				out.numbers(values, 3);
+			}
+
+			if (item.spectral.isParsed())
+			{
+				out.key("spectral");
+				out.open('{');
+				out.key("file");
+				out.string(item.spectral.file);
+				out.key("factor");
+				out.number(item.spectral.factor);
+				out.close('}');
+			}
+
+			out.close('}');
+		}
+
+		void operator()(const char* name, const Opacity& item)
+		{
+			if (!item.isParsed()) return;
+
+			out.key(name);
+			out.open('{');
+			out.key("d");
+			out.number(item.d);
+			out.key("halo");
+			out.boolean(item.halo);
+			out.close('}');
+		}
+
+		void operator()(const char* name, const Texture& item)
+		{
+			if (!item.isParsed()) return;
+
+			out.key(name);
+			out.open('{');
+
+			(*this)("file", item.file);
+
+			visit_options(item, *this);
+
+			out.close('}');
+		}
+
+		void operator()(const char* name, const Reflection& item)
+		{
+			if (!item.isParsed()) return;
+
+			out.key(name);
+			out.open('{');
+
+			visit_reflection(item, *this);
+
+			out.close('}');
+		}
+
+		void operator()(const Custom& item)
+		{
+			if (!item.isParsed()) return;
+
+			out.key(item.keyword.c_str());
+			out.open('{');
+
+			switch (item.type)
+			{
+			case Statement::color:   (*this)("color", item.color); break;
+			case Statement::scalar:  (*this)("scalar", item.scalar); break;
+			case Statement::texture: (*this)("texture", item.texture); break;
+			case Statement::string:  (*this)("string", item.text); break;
+			}
+
+			out.close('}');
+		}
+	};
+
+	inline void to_json(const Material& material, JsonWriter& out)
+	{
+		JsonFields fields{ out };
+
+		out.open('{');
+
+		fields("name", material.name);
+
+		visit(material, fields);
+
+		bool custom(false);
+
+		for (const auto& item : material.custom)
+			custom |= item.isParsed();
+
+		if (custom)
+		{
+			out.key("custom");
+			out.open('{');
+
+			for (const auto& item : material.custom)
+				fields(item);
+
+			out.close('}');
+		}
+
+		out.close('}');
+	}
+
+	inline void to_json(Load& load, JsonWriter& out)
+	{
+		out.open('{');
+
+		out.key("information");
+		out.open('[');
+
+		for (const auto& line : load.information())
+			out.string(line);
+
+		out.close(']');
+
+		out.key("materials");
+		out.open('[');
+
+		for (const auto& material : load.materials())
+		{
+			if (material.name.isParsed())
+				to_json(material, out);
+
+			out.flush();
+		}
+
+		out.close(']');
+
+		out.close('}');
+	}
+
+	inline std::string to_json(Load& load)
+	{
+		JsonWriter out;
+
+		to_json(load, out);
+
+		return std::move(out.str());
+	}
+
+	inline bool to_json(Load& load, FILE* stream)
+	{
+		if (!stream) return false;
+
+		JsonWriter out(stream);
+
+		to_json(load, out);
+
+		return out.flush();
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	struct JsonValues
+	{
+		JsonReader& in;
+
+		bool operator()(Value<double>& item)
+		{
+			double d;
+
+			if (!in.number(d)) return false;
+
+			item = d;
+
+			return true;
+		}
+
+		bool operator()(Value<int>& item)
+		{
+			double d;
+
+			if (!in.number(d)) return false;
+
+			item = static_cast<int>(d);
+
+			return true;
+		}
+
+		bool operator()(Value<bool>& item)
+		{
+			bool b;
+
+			if (!in.boolean(b)) return false;
+
+			item = b;
+
+			return true;
+		}
+
+		bool operator()(Value<char>& item)
+		{
+			std::string text;
+
+			if (!in.string(text) || text.empty()) return false;
+
+			item = text.front();
+
+			return true;
+		}
+
+		bool operator()(Value<std::string>& item)
+		{
+			std::string text;
+
+			if (!in.string(text)) return false;
+
+			item = text;
+
+			return true;
+		}
+
+		bool operator()(Model& item)
+		{
+			double values[2];
+
+			if (!in.numbers(values, 2)) return false;
+
+			item.base = static_cast<int>(values[0]);
+			item.gain = static_cast<int>(values[1]);
+
+			return item.parsed();
+		}
+
+		bool operator()(uvw& item)
+		{
+			double values[3];
+
+			if (!in.numbers(values, 3)) return false;
+
+			item = uvw(values[0], values[1], values[2]);
+
+			return item.parsed();
+		}
+
+		bool operator()(Color& item)
+		{
+			bool linear(false);
+
+			const bool good = in.object([&](const std::string& name)
+			{
+				double values[3];
+
+				if (name == "linear")
+					return in.boolean(linear);
+
+				if (name == "rgb")
+				{
+					if (!in.numbers(values, 3)) return false;
+
+					item.color = rgb(values[0], values[1], values[2]);
+
+					return item.color.parsed();
+				}
+
+				if (name == "xyz")
+				{
+					if (!in.numbers(values, 3)) return false;
+
+					item.color_space = xyz(values[0], values[1], values[2]);
+
+					return item.color_space.parsed();
+				}
+
+				if (name == "spectral")
+				{
+					return item.spectral.parsed(in.object([&](const std::string& field)
+					{
+						if (field == "file") return in.string(item.spectral.file);
+
+						if (field == "factor") return in.number(item.spectral.factor);
+
+						return in.skip();
+					}));
+				}
+
+				return in.skip();
+			});
+
+			if (linear)
+				item.color.encoding = Encoding::linear;
+
+			return item.parsed(good);
+		}
+
+		bool operator()(Opacity& item)
+		{
+			return item.parsed(in.object([&](const std::string& name)
+			{
+				if (name == "d") return in.number(item.d);
+
+				if (name == "halo") return in.boolean(item.halo);
+
+				return in.skip();
+			}));
+		}
+
+		bool operator()(Texture& item)
+		{
+			return item.parsed(in.object([&](const std::string& name)
+			{
+				if (name == "file") return (*this)(item.file);
+
+				return field(item, name, visit_options<Texture, Forward>);
+			}));
+		}
+
+		bool operator()(Reflection& item)
+		{
+			return item.parsed(in.object([&](const std::string& name)
+			{
+				return field(item, name, visit_reflection<Reflection, Forward>);
+			}));
+		}
+
+		bool operator()(Custom& item)
+		{
+			return item.parsed(in.object([&](const std::string& name)
+			{
+				if (name == "color") { item.type = Statement::color; return (*this)(item.color); }
+
+				if (name == "scalar") { item.type = Statement::scalar; return (*this)(item.scalar); }
+
+				if (name == "texture") { item.type = Statement::texture; return (*this)(item.texture); }
+
+				if (name == "string") { item.type = Statement::string; return (*this)(item.text); }
+
+				return in.skip();
+			}));
+		}
+
+		// Parses the value of the member with the given name, skips unknown members
+
+		struct Forward
+		{
+			JsonValues& values;
+
+			const std::string& name;
+
+			bool& found;
+
+			bool& good;
+
+			template <typename T>
+			void operator()(const char* field, T& item)
+			{
+				if (found || name != field) return;
+
+				found = true;
+
+				good = values(item);
+			}
+		};
+
+		template <typename T>
+		bool field(T& item, const std::string& name, void (*visitor)(T&, Forward&&))
+		{
+			bool found(false);
+
+			bool good(false);
+
+			visitor(item, Forward{ *this, name, found, good });
+
+			return found ? good : in.skip();
+		}
+	};
+
+	inline bool from_json(JsonReader& in, Material& material)
+	{
+		JsonValues values{ in };
+
+		return in.object([&](const std::string& name)
+		{
+			if (name == "name") return values(material.name);
+
+			if (name == "custom")
+			{
+				return in.object([&](const std::string& keyword)
+				{
+					Custom custom;
+
+					custom.keyword = keyword;
+
+					if (!values(custom)) return false;
+
+					material.custom.emplace_back(custom);
+
+					return true;
+				});
+			}
+
+			return values.field(material, name, visit<Material, JsonValues::Forward>);
+		});
+	}
+
+	inline bool from_json(const char* data, size_t size, Load& load)
+	{
+		load.materials().clear();
+
+		load.information().clear();
+
+		JsonReader in(data, size);
+
+		const bool good = in.object([&](const std::string& name)
+		{
+			if (name == "information")
+			{
+				return in.array([&]()
+				{
+					std::string line;
+
+					if (!in.string(line)) return false;
+
+					load.information().emplace_back(line);
+
+					return true;
+				});
+			}
+
+			if (name == "materials")
+			{
+				return in.array([&]()
+				{
+					load.materials().emplace_back();
+
+					return from_json(in, load.materials().back());
+				});
+			}
+
+			return in.skip();
+		});
+
+		return good && in.done() && !load.materials().empty();
+	}
+
+	inline bool from_json(const std::string& text, Load& load)
+	{
+		return from_json(text.data(), text.size(), load);
+	}
+}
@@ -0,0 +1,403 @@
+/*
+  LintMTL.h
+
+  C++ code solution for validating Wavefront MTL materials
+
+  A Lint holds a set of rules. A rule names the statements it checks, or none
+  for every statement of its kind; when it is added it is compiled into the
+  list of checks of each field it applies to, so each material is visited
+  once and every field runs only its own checks, without comparing keywords.
+  Materials are checked in parallel. Each problem is reported as an Issue
+  with rule, material and keyword, and can be written as JSON.
+
+	Ns       Shininess outside [0..1000]
+	illum    Illumination model outside [0..10]
+	color    Negative color component (Kd, Ka, Ks, Tf, Ke)
+	range    Factor outside [0..1] (d, Tr, Pr, Pm, Ps, Pc, Pcr, aniso, anisor)
+	imfchan  -imfchan not one of r, g, b, m, l, z
+	file     Texture file does not exist (relative to the MTL folder)
+	name     Duplicate newmtl name
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "JsonMTL.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+namespace mtl
+{
+	enum class Severity { warning, error };
+
+	struct Issue
+	{
+		std::string rule;     // Rule name
+		Severity    severity; // Severity of the rule
+		size_t      material; // Index in Load::materials
+		std::string name;     // Material name
+		std::string keyword;  // Statement
+		std::string message;  // Description
+	};
+
+	struct Rule
+	{
+		Rule(const std::string& name, Severity severity, const std::vector<std::string>& keywords = {}) : name(name), severity(severity), keywords(keywords) {}
+
+		std::string              name;     // Rule name
+		Severity                 severity; // Severity of an issue
+		std::vector<std::string> keywords; // Statements checked, empty for all statements of the kind of the check
+
+		std::function<bool(const char* keyword, double value, std::string& message)>         scalar;  // Check of a number
+		std::function<bool(const char* keyword, const rgb& color, std::string& message)>     color;   // Check of a color
+		std::function<bool(const char* keyword, const Texture& texture, std::string& message)> texture; // Check of a texture
+	};
+
+	class Lint
+	{
+	public:
+
+		explicit Lint(const std::string& folder = std::string());
+
+		void add(const Rule& rule);
+
+		std::vector<Issue> check(Load& load, size_t threads = 0) const;
+
+	private:
+
+		enum class Field : uint8_t { scalar, color, texture };
+
+		void check(const Material& material, size_t index, std::vector<Issue>& issues) const;
+
+		struct Fields
+		{
+			std::vector<std::pair<std::string, Field>>& fields;
+
+			void operator()(const char* keyword, const Color&) { fields.emplace_back(keyword, Field::color); }
+
+			void operator()(const char* keyword, const Texture&) { fields.emplace_back(keyword, Field::texture); }
+
+			void operator()(const char* keyword, const Reflection&) { fields.emplace_back(keyword, Field::texture); }
+
+			template <typename T>
+			void operator()(const char* keyword, const T&) { fields.emplace_back(keyword, Field::scalar); }
+		};
+
+		struct Checks
+		{
+			const Lint& lint;
+
+			const Material& material;
+
+			size_t index;
+
+			std::vector<Issue>& issues;
+
+			size_t i; // Field in visit order
+
+			std::string message;
+
+			void report(const Rule* rule, const char* keyword)
+			{
+				issues.push_back({ rule->name, rule->severity, index, material.name.value, keyword, message });
+
+				message.clear();
+			}
+
+			void scalar(const char* keyword, bool parsed, double value)
+			{
+				if (parsed)
+					for (const auto* rule : lint.checks[i])
+						if (!rule->scalar(keyword, value, message))
+							report(rule, keyword);
+				i++;
+			}
+
+			void texture(const char* keyword, const Texture& item)
+			{
+				if (item.isParsed())
+					for (const auto* rule : lint.checks[i])
+						if (!rule->texture(keyword, item, message))
+							report(rule, keyword);
+			}
+
+			void operator()(const char* keyword, const Value<double>& item) { scalar(keyword, item.isParsed(), item.value); }
+
+			void operator()(const char* keyword, const Value<int>& item) { scalar(keyword, item.isParsed(), item.value); }
+
+			void operator()(const char* keyword, const Opacity& item) { scalar(keyword, item.isParsed(), item.d); }
+
+			void operator()(const char* keyword, const Color& item)
+			{
+				if (item.color.isParsed())
+					for (const auto* rule : lint.checks[i])
+						if (!rule->color(keyword, item.color, message))
+							report(rule, keyword);
+				i++;
+			}
+
+			void operator()(const char* keyword, const Texture& item) { texture(keyword, item); i++; }
+
+			void operator()(const char* keyword, const Reflection& item)
+			{
+				visit_reflection(item, [&](const char*, const Texture& cube) { texture(keyword, cube); });
+
+				i++;
+			}
+		};
+
+		std::vector<std::pair<std::string, Field>> fields; // Statement and kind of each field in visit order
+
+		std::vector<std::vector<const Rule*>> checks; // Rules of each field, compiled by add
+
+		std::vector<std::unique_ptr<Rule>> rules;
+
+		std::string folder; // Folder of texture files, empty to skip the file rule
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline bool file_exists(const std::string& path)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+
+		if (!file) return false;
+
+		fclose(file);
+
+		return true;
+	}
+
+	inline Lint::Lint(const std::string& folder) : folder(folder)
+	{
+		auto format = [](const char* keyword, double value, const char* range)
+		{
+			char text[128];
+
+			snprintf(text, sizeof text, "%s %g outside %s", keyword, value, range);
+
+			return std::string(text);
+		};
+
+		const Material defaults;
+
+		visit(defaults, Fields{ fields });
+
+		checks.resize(fields.size());
+
+		Rule Ns{ "Ns", Severity::warning, { "Ns" } };
+
+		Ns.scalar = [=](const char* keyword, double value, std::string& message)
+		{
+			if (value >= 0 && value <= 1000) return true;
+
+			message = format(keyword, value, "[0..1000]");
+
+			return false;
+		};
+
+		add(Ns);
+
+		Rule illum{ "illum", Severity::error, { "illum" } };
+
+		illum.scalar = [=](const char* keyword, double value, std::string& message)
+		{
+			if (value >= 0 && value <= 10) return true;
+
+			message = format(keyword, value, "[0..10]");
+
+			return false;
+		};
+
+		add(illum);
+
+		Rule range{ "range", Severity::warning, { "d", "Tr", "Pr", "Pm", "Ps", "Pc", "Pcr", "aniso", "anisor" } };
+
+		range.scalar = [=](const char* keyword, double value, std::string& message)
+		{
+			if (value >= 0 && value <= 1) return true;
+
+			message = format(keyword, value, "[0..1]");
+
+			return false;
+		};
+
+		add(range);
+
+		Rule color{ "color", Severity::warning };
+
+		color.color = [](const char* keyword, const rgb& item, std::string& message)
+		{
+			if (item.r >= 0 && item.g >= 0 && item.b >= 0) return true;
+
+			char text[160];
+
+			snprintf(text, sizeof text, "%s %g %g %g has a negative component", keyword, item.r, item.g, item.b);
+
+			message = text;
+
+			return false;
+		};
+
+		add(color);
+
+		Rule imfchan{ "imfchan", Severity::error };
+
+		imfchan.texture = [](const char* keyword, const Texture& item, std::string& message)
+		{
+			// The parser keeps the first character of a value naming a channel anywhere ("xr" is 'x')
+
+			const char channel = item.imfchan.isParsed() ? item.imfchan.value : 'm';
+
+			if (channel && std::strchr("rgbmlz", channel)) return true;
+
+			message = std::string(keyword) + " -imfchan " + channel + " is not one of r, g, b, m, l, z";
+
+			return false;
+		};
+
+		add(imfchan);
+
+		if (folder.empty()) return;
+
+		Rule file{ "file", Severity::error };
+
+		file.texture = [folder](const char*, const Texture& item, std::string& message)
+		{
+			if (!item.file.isParsed() || item.file.value.empty()) return true;
+
+			auto path = item.file.value;
+
+			std::replace(path.begin(), path.end(), '\\', '/');
+
+			if (path.front() != '/' && !(path.size() > 1 && path[1] == ':'))
+				path = folder + "/" + path;
+
+			if (file_exists(path)) return true;
+
+			message = "texture file " + item.file.value + " not found";
+
+			return false;
+		};
+
+		add(file);
+	}
+
+	inline void Lint::add(const Rule& rule)
+	{
+		rules.emplace_back(new Rule(rule));
+
+		const Rule* item = rules.back().get();
+
+		for (size_t i = 0; i < fields.size(); i++)
+		{
+			const auto& keywords = item->keywords;
+
+			if (!keywords.empty() && std::find(keywords.begin(), keywords.end(), fields[i].first) == keywords.end())
+				continue;
+
+			const Field kind = fields[i].second;
+
+			if ((kind == Field::scalar && item->scalar) || (kind == Field::color && item->color) || (kind == Field::texture && item->texture))
+				checks[i].push_back(item);
+		}
+	}
+
+	inline void Lint::check(const Material& material, size_t index, std::vector<Issue>& issues) const
+	{
+		visit(material, Checks{ *this, material, index, issues, 0, std::string() });
+	}
+
+	inline std::vector<Issue> Lint::check(Load& load, size_t threads) const
+	{
+		const auto& materials = load.materials();
+
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+
+		threads = std::min(threads, std::max<size_t>(1, materials.size() / 256));
+
+		std::vector<std::vector<Issue>> found(threads);
+
+		std::vector<std::thread> workers;
+
+		const size_t chunk = (materials.size() + threads - 1) / threads;
+
+		for (size_t t = 0; t < threads; t++)
+		{
+			auto work = [&, t]()
+			{
+				const size_t end = std::min(materials.size(), (t + 1) * chunk);
+
+				for (size_t i = t * chunk; i < end; i++)
+					if (materials[i].name.isParsed())
+						check(materials[i], i, found[t]);
+			};
+
+			if (t + 1 == threads)
+				work();
+			else
+				workers.emplace_back(work);
+		}
+
+		for (auto& worker : workers)
+			worker.join();
+
+		std::vector<Issue> issues;
+
+		for (auto& list : found)
+			issues.insert(issues.end(), list.begin(), list.end());
+
+		std::unordered_map<std::string, size_t> names;
+
+		for (size_t i = 0; i < materials.size(); i++)
+		{
+			const auto& name = materials[i].name;
+
+			if (!name.isParsed()) continue;
+
+			const auto first = names.emplace(name.value, i);
+
+			if (!first.second)
+				issues.push_back({ "name", Severity::error, i, name.value, "newmtl", "duplicate of material " + std::to_string(first.first->second) });
+		}
+
+		return issues;
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline void to_json(const std::vector<Issue>& issues, const std::string& path, JsonWriter& out)
+	{
+		for (const auto& issue : issues)
+		{
+			out.open('{');
+			out.key("file");
+			out.string(path);
+			out.key("rule");
+			out.string(issue.rule);
+			out.key("severity");
+			out.string(issue.severity == Severity::error ? "error" : "warning");
+			out.key("material");
+			out.string(issue.name);
+			out.key("keyword");
+			out.string(issue.keyword);
+			out.key("message");
+			out.string(issue.message);
+			out.close('}');
+
+			out.flush();
+		}
+	}
+}
@@ -0,0 +1,293 @@
+/*
+  PackMTL.h
+
+  C++ code solution for packing Wavefront MTL materials into GPU tables
+
+  A Pack holds the materials of a library as structure of arrays: one column
+  per statement, in the order of mtl::visit, with one row per material. The
+  columns can be uploaded as they are to storage buffers and indexed by the
+  material index.
+
+	color      3 floats per material (rgb, xyz and spectral are not packed)
+	scalar     1 float per material (d for the dissolve statement)
+	texture    1 int32 per material, index in the texture table or -1
+	refl       as texture, the sphere map (cube maps are not packed)
+
+  A bit per statement in the present mask tells if the value was parsed; the
+  column holds the Material default otherwise. Texture options and user
+  registered statements are not packed.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "BinaryMTL.h"
+
+#include <unordered_map>
+
+namespace mtl
+{
+	enum class Kind : uint8_t { scalar, color, texture };
+
+	struct Column
+	{
+		std::string          keyword; // Statement
+		Kind                 kind;    // Layout of the rows
+		std::vector<float>   values;  // Rows of scalar (1) and color (3) columns
+		std::vector<int32_t> index;   // Rows of texture columns
+	};
+
+	class Pack
+	{
+	public:
+
+		void build(Load& load);
+
+		size_t size() const { return names.size(); }
+
+		const Column* column(const std::string& keyword) const;
+
+		std::string serialize() const;
+
+		size_t deduplicate(const std::vector<uint64_t>& keys);
+
+		std::vector<std::string> names; // Material names
+
+		std::vector<Column> columns; // One per statement, in visit order
+
+		std::vector<uint64_t> present; // Parsed statements, bit i is columns[i]
+
+		std::vector<std::string> textures; // Unique texture files
+
+	private:
+
+		int32_t texture(const Texture& texture);
+
+		struct Layout
+		{
+			std::vector<Column>& columns;
+
+			void add(const char* keyword, Kind kind) { columns.push_back({ keyword, kind, {}, {} }); }
+
+			void operator()(const char* keyword, const Color&) { add(keyword, Kind::color); }
+
+			void operator()(const char* keyword, const Texture&) { add(keyword, Kind::texture); }
+
+			void operator()(const char* keyword, const Reflection&) { add(keyword, Kind::texture); }
+
+			template <typename T>
+			void operator()(const char* keyword, const T&) { add(keyword, Kind::scalar); }
+		};
+
+		struct Row
+		{
+			Pack& pack;
+
+			uint64_t mask;
+
+			size_t i;
+
+			void next(const Parse& item) { mask |= static_cast<uint64_t>(item.isParsed()) << i; }
+
+			void operator()(const char*, const Color& item)
+			{
+				auto& values = pack.columns[i].values;
+
+				values.push_back(static_cast<float>(item.color.r));
+				values.push_back(static_cast<float>(item.color.g));
+				values.push_back(static_cast<float>(item.color.b));
+
+				next(item);
+				i++;
+			}
+
+			void operator()(const char*, const Texture& item)
+			{
+				pack.columns[i].index.push_back(pack.texture(item));
+
+				next(item);
+				i++;
+			}
+
+			void operator()(const char*, const Reflection& item)
+			{
+				pack.columns[i].index.push_back(pack.texture(item.sphere));
+
+				next(item);
+				i++;
+			}
+
+			void operator()(const char*, const Opacity& item)
+			{
+				pack.columns[i].values.push_back(static_cast<float>(item.d));
+
+				next(item);
+				i++;
+			}
+
+			template <typename T>
+			void operator()(const char*, const Value<T>& item)
+			{
+				pack.columns[i].values.push_back(static_cast<float>(item.value));
+
+				next(item);
+				i++;
+			}
+		};
+
+		std::unordered_map<std::string, int32_t> files; // Texture index by file
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline int32_t Pack::texture(const Texture& item)
+	{
+		if (!item.isParsed() || !item.file.isParsed()) return -1;
+
+		const auto found = files.emplace(item.file.value, static_cast<int32_t>(textures.size()));
+
+		if (found.second)
+			textures.push_back(item.file.value);
+
+		return found.first->second;
+	}
+
+	inline void Pack::build(Load& load)
+	{
+		names.clear();
+		columns.clear();
+		present.clear();
+		textures.clear();
+		files.clear();
+
+		const Material defaults;
+
+		visit(defaults, Layout{ columns });
+
+		for (const auto& material : load.materials())
+			if (material.name.isParsed())
+				names.push_back(material.name.value);
+
+		for (auto& column : columns)
+		{
+			if (column.kind == Kind::texture)
+				column.index.reserve(size());
+			else
+				column.values.reserve(size() * (column.kind == Kind::color ? 3 : 1));
+		}
+
+		present.reserve(size());
+
+		for (const auto& material : load.materials())
+		{
+			if (!material.name.isParsed()) continue;
+
+			Row row{ *this, 0, 0 };
+
+			visit(material, row);
+
+			present.push_back(row.mask);
+		}
+	}
+
+	// Joins textures with equal keys, one per entry of the texture table, into
+	// the first of them. A key of 0 is unknown and never joined. Returns the
+	// number of textures removed.
+
+	inline size_t Pack::deduplicate(const std::vector<uint64_t>& keys)
+	{
+		if (keys.size() != textures.size()) return 0;
+
+		std::unordered_map<uint64_t, int32_t> first;
+
+		std::vector<int32_t> remap(textures.size());
+
+		std::vector<std::string> kept;
+
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			const int32_t next = static_cast<int32_t>(kept.size());
+
+			remap[i] = keys[i] ? first.emplace(keys[i], next).first->second : next;
+
+			if (remap[i] == next)
+				kept.push_back(std::move(textures[i]));
+		}
+
+		const size_t removed = textures.size() - kept.size();
+
+		textures = std::move(kept);
+
+		for (auto& column : columns)
+			for (auto& index : column.index)
+				if (index >= 0) index = remap[index];
+
+		for (auto& item : files)
+			item.second = remap[item.second];
+
+		return removed;
+	}
+
+	inline const Column* Pack::column(const std::string& keyword) const
+	{
+		for (const auto& item : columns)
+			if (item.keyword == keyword)
+				return &item;
+
+		return nullptr;
+	}
+
+	// Layout: "MTLS", version, materials, columns, textures, then names,
+	// columns (keyword, kind, rows aligned to 8 bytes), present and textures.
+
+	inline std::string Pack::serialize() const
+	{
+		BinaryWriter out;
+
+		out.put("MTLS", 4);
+		out.put(static_cast<uint32_t>(1));
+		out.put(static_cast<uint32_t>(size()));
+		out.put(static_cast<uint32_t>(columns.size()));
+		out.put(static_cast<uint32_t>(textures.size()));
+
+		for (const auto& name : names)
+			out.put(name);
+
+		for (const auto& item : columns)
+		{
+			out.put(item.keyword);
+			out.put(static_cast<uint8_t>(item.kind));
+			out.align(8);
+
+			if (item.kind == Kind::texture)
+				out.put(item.index.data(), item.index.size() * sizeof(int32_t));
+			else
+				out.put(item.values.data(), item.values.size() * sizeof(float));
+		}
+
+		out.align(8);
+		out.put(present.data(), present.size() * sizeof(uint64_t));
+
+		for (const auto& file : textures)
+			out.put(file);
+
+		return std::move(out.str());
+	}
+
+	inline std::string to_pack(Load& load)
+	{
+		Pack pack;
+
+		pack.build(load);
+
+		return pack.serialize();
+	}
+}
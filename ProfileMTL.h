@@ -0,0 +1,271 @@
+/*
+  ProfileMTL.h
+
+  C++ code solution for recording the profiler zones of WavefrontMTL
+
+  With WAVEFRONT_MTL_PROFILE defined, the parser marks its phases with zones
+  (load, open, parse and index; read for every line and tokenize, dispatch
+  and texture for every statement with WAVEFRONT_MTL_PROFILE=2). A ChromeTrace attached to the
+  profiler hooks records the zones of all threads and writes them in the
+  Chrome trace event format, to be opened in about://tracing or Perfetto.
+  Every thread records to its own buffer, so loading in parallel does not
+  contend on a lock; a buffer's lock is only taken by another thread while the
+  trace is written, cleared or counted.
+
+	#define WAVEFRONT_MTL_PROFILE
+	#include "ProfileMTL.h"
+
+	mtl::ChromeTrace trace;
+	trace.attach();
+	file.load("scene.mtl");
+	trace.write(fopen("trace.json", "wb"));
+
+  Without WAVEFRONT_MTL_PROFILE the recorder compiles but records nothing.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "JsonMTL.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+namespace mtl
+{
+	class ChromeTrace
+	{
+	public:
+
+		ChromeTrace() : epoch(std::chrono::steady_clock::now()), id(instances().fetch_add(1) + 1) {}
+
+		~ChromeTrace() { detach(); }
+
+		void attach();
+
+		void detach();
+
+		void clear();
+
+		size_t size() const;
+
+		void write(JsonWriter& out) const;
+
+		bool write(FILE* stream) const;
+
+		std::string json() const;
+
+	private:
+
+		struct Event
+		{
+			const char* name;  // Zone name, a literal
+			std::string text;  // Optional argument
+			char        phase; // 'B' begin, 'E' end
+			double      us;    // Microseconds since epoch
+		};
+
+		struct Buffer
+		{
+			explicit Buffer(uint32_t tid) : tid(tid) {}
+
+			const uint32_t     tid;
+			std::mutex         lock;   // Taken by the recording thread and by readers
+			std::vector<Event> events;
+		};
+
+		Buffer& buffer();
+
+		static std::atomic<uint64_t>& instances() { static std::atomic<uint64_t> count(0); return count; }
+
+		double now() const { return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count(); }
+
+		static void begin(const char* name, const char* text, void* user);
+
+		static void end(const char* name, void* user);
+
+		std::chrono::steady_clock::time_point epoch;
+
+		const uint64_t id; // Unique per recorder, identifies the thread local buffer
+
+		mutable std::mutex lock; // Guards the list of buffers, each buffer has its own lock
+
+		std::vector<std::unique_ptr<Buffer>> buffers; // One per recording thread
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline void ChromeTrace::attach()
+	{
+#ifdef WAVEFRONT_MTL_ZONES
+		profiler() = { &ChromeTrace::begin, &ChromeTrace::end, this };
+#endif
+	}
+
+	inline void ChromeTrace::detach()
+	{
+#ifdef WAVEFRONT_MTL_ZONES
+		if (profiler().user == this)
+			profiler() = { nullptr, nullptr, nullptr };
+#endif
+	}
+
+	inline void ChromeTrace::clear()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		for (auto& item : buffers)
+		{
+			std::lock_guard<std::mutex> hold(item->lock);
+
+			item->events.clear();
+		}
+	}
+
+	inline size_t ChromeTrace::size() const
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		size_t count(0);
+
+		for (const auto& item : buffers)
+		{
+			std::lock_guard<std::mutex> hold(item->lock);
+
+			count += item->events.size();
+		}
+
+		return count;
+	}
+
+	inline ChromeTrace::Buffer& ChromeTrace::buffer()
+	{
+		struct Cache
+		{
+			uint64_t owner;
+			Buffer*  buffer;
+		};
+
+		thread_local Cache cache = { 0, nullptr };
+
+		if (cache.owner == id)
+			return *cache.buffer;
+
+		std::lock_guard<std::mutex> guard(lock);
+
+		buffers.emplace_back(new Buffer(static_cast<uint32_t>(buffers.size() + 1)));
+
+		cache = { id, buffers.back().get() };
+
+		return *cache.buffer;
+	}
+
+	inline void ChromeTrace::begin(const char* name, const char* text, void* user)
+	{
+		auto* trace = static_cast<ChromeTrace*>(user);
+
+		auto& item = trace->buffer();
+
+		std::lock_guard<std::mutex> hold(item.lock); // Uncontended unless the trace is being read
+
+		item.events.push_back({ name, text ? text : "", 'B', trace->now() });
+	}
+
+	inline void ChromeTrace::end(const char* name, void* user)
+	{
+		auto* trace = static_cast<ChromeTrace*>(user);
+
+		auto& item = trace->buffer();
+
+		std::lock_guard<std::mutex> hold(item.lock);
+
+		item.events.push_back({ name, std::string(), 'E', trace->now() });
+	}
+
+	inline void ChromeTrace::write(JsonWriter& out) const
+	{
+		std::vector<std::pair<uint32_t, std::vector<Event>>> snapshot; // Threads may still record while writing
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			for (const auto& item : buffers)
+			{
+				std::lock_guard<std::mutex> hold(item->lock);
+
+				snapshot.emplace_back(item->tid, item->events);
+			}
+		}
+
+		out.open('{');
+		out.key("traceEvents");
+		out.open('[');
+
+		for (const auto& item : snapshot)
+		{
+			for (const auto& event : item.second)
+			{
+				const char phase[] = { event.phase, '\0' };
+
+				out.open('{');
+				out.key("name");
+				out.string(event.name);
+				out.key("ph");
+				out.string(phase);
+				out.key("ts");
+				out.number(event.us);
+				out.key("pid");
+				out.number(1);
+				out.key("tid");
+				out.number(static_cast<int>(item.first));
+
+				if (!event.text.empty())
+				{
+					out.key("args");
+					out.open('{');
+					out.key("path");
+					out.string(event.text);
+					out.close('}');
+				}
+
+				out.close('}');
+
+				out.flush();
+			}
+		}
+
+		out.close(']');
+		out.key("displayTimeUnit");
+		out.string("ms");
+		out.close('}');
+	}
+
+	inline bool ChromeTrace::write(FILE* stream) const
+	{
+		if (!stream) return false;
+
+		JsonWriter out(stream);
+
+		write(out);
+
+		return out.flush();
+	}
+
+	inline std::string ChromeTrace::json() const
+	{
+		JsonWriter out;
+
+		write(out);
+
+		return std::move(out.str());
+	}
+}
@@ -0,0 +1,188 @@
+/*
+  SamplerMTL.h
+
+  C++ code solution for deriving sampler state from Wavefront MTL texture options
+
+  The texture options that select how a texture is sampled are reduced to a
+  canonical Sampler, so equal states compare equal however they were written:
+
+	-clamp on|off       -> wrap, clamp or repeat (repeat if not given)
+	-blendu on|off      -> filter along u, linear or nearest (linear if not given)
+	-blendv on|off      -> filter along v
+	-imfchan r|g|b|m|l|z -> swizzle, the channel a scalar texture reads
+
+  -imfchan only applies to scalar textures (map_Ns, map_d, map_bump, bump,
+  disp, decal and the PBR scalar maps). Without it they read luminance, and
+  decal reads matte. Color textures (map_Kd, map_Ka, map_Ks, map_Ke, norm,
+  map_RMA, map_ORM and refl) always read rgba.
+
+  Samplers interns the state of every texture slot of a library into a small
+  table; a renderer creates one sampler object per table entry and looks up
+  the entry of each material and slot.
+
+	mtl::Samplers samplers;
+	samplers.build(file);
+
+	for (const mtl::Sampler& state : samplers.table) ...
+	int32_t entry = samplers.slot(material, 0);  // Slot 0 is map_Kd
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "WavefrontMTL.h"
+
+namespace mtl
+{
+	enum class Wrap : uint8_t { repeat, clamp };
+
+	enum class Filter : uint8_t { linear, nearest };
+
+	enum class Swizzle : uint8_t { rgba, r, g, b, matte, luminance, depth };
+
+	struct Sampler
+	{
+		Wrap    wrap;    // -clamp
+		Filter  u;       // -blendu
+		Filter  v;       // -blendv
+		Swizzle swizzle; // -imfchan
+
+		bool operator==(const Sampler& other) const { return wrap == other.wrap && u == other.u && v == other.v && swizzle == other.swizzle; }
+
+		bool operator!=(const Sampler& other) const { return !(*this == other); }
+	};
+
+	inline Swizzle swizzle(char channel)
+	{
+		switch (channel)
+		{
+		case 'r': return Swizzle::r;
+		case 'g': return Swizzle::g;
+		case 'b': return Swizzle::b;
+		case 'm': return Swizzle::matte;
+		case 'z': return Swizzle::depth;
+		default:  return Swizzle::luminance;
+		}
+	}
+
+	// State of a texture, fallback is the swizzle when -imfchan is not given
+
+	inline Sampler sampler(const Texture& texture, Swizzle fallback = Swizzle::rgba)
+	{
+		Sampler state = { Wrap::repeat, Filter::linear, Filter::linear, fallback };
+
+		if (texture.clamp.isParsed() && texture.clamp.value) state.wrap = Wrap::clamp;
+
+		if (texture.blendu.isParsed() && !texture.blendu.value) state.u = Filter::nearest;
+
+		if (texture.blendv.isParsed() && !texture.blendv.value) state.v = Filter::nearest;
+
+		if (fallback != Swizzle::rgba && texture.imfchan.isParsed()) state.swizzle = swizzle(texture.imfchan.value);
+
+		return state;
+	}
+
+	// State of a texture in the slot of the given statement
+
+	inline Sampler sampler(const char* keyword, const Texture& texture)
+	{
+		static const char* color[] = { "map_Kd", "map_Ka", "map_Ks", "map_Ke", "norm", "map_RMA", "map_ORM", "refl" };
+
+		for (const char* item : color)
+			if (std::strcmp(item, keyword) == 0)
+				return sampler(texture);
+
+		return sampler(texture, std::strcmp(keyword, "decal") == 0 ? Swizzle::matte : Swizzle::luminance);
+	}
+
+	class Samplers
+	{
+	public:
+
+		void build(Load& load);
+
+		int32_t add(const Sampler& state);
+
+		size_t size() const { return table.size(); }
+
+		int32_t slot(size_t material, size_t slot) const { return slots[material * keywords.size() + slot]; }
+
+		std::vector<Sampler> table; // Unique sampler states
+
+		std::vector<std::string> keywords; // Texture slots in visit order
+
+		std::vector<int32_t> slots; // Table entry of each material and slot, -1 if the slot has no texture
+
+	private:
+
+		struct Slots
+		{
+			Samplers& samplers;
+
+			void operator()(const char*, const Texture& item) { samplers.slots.push_back(item.isParsed() ? samplers.add(sampler(keyword(), item)) : -1); }
+
+			void operator()(const char*, const Reflection& item)
+			{
+				const Texture* first = nullptr; // Cube faces share the sampler of the first parsed face
+
+				visit_reflection(item, [&](const char*, const Texture& face) { if (!first && face.isParsed()) first = &face; });
+
+				samplers.slots.push_back(first ? samplers.add(sampler("refl", *first)) : -1);
+			}
+
+			template <typename T>
+			void operator()(const char*, const T&) {}
+
+			const char* keyword() const { return samplers.keywords[samplers.slots.size() % samplers.keywords.size()].c_str(); }
+		};
+
+		struct Keywords
+		{
+			std::vector<std::string>& keywords;
+
+			void operator()(const char* keyword, const Texture&) { keywords.push_back(keyword); }
+
+			void operator()(const char* keyword, const Reflection&) { keywords.push_back(keyword); }
+
+			template <typename T>
+			void operator()(const char*, const T&) {}
+		};
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline int32_t Samplers::add(const Sampler& state)
+	{
+		const auto found = std::find(table.begin(), table.end(), state);
+
+		if (found != table.end())
+			return static_cast<int32_t>(found - table.begin());
+
+		table.push_back(state);
+
+		return static_cast<int32_t>(table.size() - 1);
+	}
+
+	inline void Samplers::build(Load& load)
+	{
+		table.clear();
+		keywords.clear();
+		slots.clear();
+
+		const Material defaults;
+
+		visit(defaults, Keywords{ keywords });
+
+		for (const auto& material : load.materials())
+			if (material.name.isParsed())
+				visit(material, Slots{ *this });
+	}
+}
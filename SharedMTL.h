@@ -0,0 +1,357 @@
+/*
+  SharedMTL.h
+
+  C++ code solution for sharing parsed Wavefront MTL libraries between processes
+
+  A library is published once as a binary cache (BinaryMTL.h) in a named
+  POSIX shared memory segment. Other processes on the host attach the segment
+  read-only and decode materials from it without parsing; the cache only
+  holds offsets, so it is valid at any address it is mapped to.
+
+	mtl::Shared::publish("/scene", file);         // Renderer, after loading
+
+	mtl::Shared shared;
+	shared.attach("/scene");                      // Baker, previewer
+	shared.binary().lookup("Brick", material);
+
+  Every publish writes a new segment "<name>.<version>" and then switches the
+  control segment "<name>" to it, so readers never see a partly written
+  library. The segment it replaces is unlinked; processes attached to it keep
+  their mapping until they detach. stale() tells a reader that a newer version
+  was published, attach() again to move to it. remove() unlinks the library.
+
+  Segments are created with mode 0600, so only processes of the user that
+  publishes a library can attach it. The control segment is created with
+  O_EXCL, and publish() and remove() refuse one that belongs to another user.
+
+  Not available on Windows, where publish() and attach() return false.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "BinaryMTL.h"
+
+#include <atomic>
+#include <cerrno>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace mtl
+{
+	struct SharedControl
+	{
+		std::atomic<uint64_t> current; // Published version, 0 if none
+		std::atomic<uint64_t> next;    // Last version handed out to a publisher
+	};
+
+	struct SharedHeader
+	{
+		char     magic[4]; // "MTLM"
+		uint32_t binary;   // BINARY_VERSION of the cache
+		uint64_t version;  // Version of the library
+		uint64_t size;     // Size of the cache in bytes
+		uint64_t offset;   // Offset of the cache in the segment
+	};
+
+	class Shared
+	{
+	public:
+
+		Shared() : map(nullptr), length(0), current(0) {}
+
+		~Shared() { detach(); }
+
+		Shared(const Shared&) = delete;
+
+		Shared& operator=(const Shared&) = delete;
+
+		static bool publish(const std::string& name, Load& load, uint64_t* version = nullptr);
+
+		static bool publish(const std::string& name, const std::string& cache, uint64_t* version = nullptr);
+
+		static bool remove(const std::string& name);
+
+		bool attach(const std::string& name);
+
+		void detach();
+
+		bool stale() const;
+
+		uint64_t version() const { return current; }
+
+		const Binary& binary() const { return cache; }
+
+		static std::string segment(const std::string& name, uint64_t version);
+
+	private:
+
+		static std::string control(const std::string& name) { return name.empty() || name[0] != '/' ? '/' + name : name; }
+
+		static SharedControl* open(const std::string& name, bool write, bool create = false);
+
+		static void close(SharedControl* control) { if (control) unmap(control, sizeof(SharedControl)); }
+
+		static void unmap(void* data, size_t size);
+
+		void* map; // Mapped data segment
+
+		size_t length; // Size of the mapping
+
+		uint64_t current; // Attached version
+
+		std::string path; // Control segment of the attached library
+
+		Binary cache;
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline std::string Shared::segment(const std::string& name, uint64_t version)
+	{
+		return control(name) + '.' + std::to_string(version);
+	}
+
+	inline void Shared::unmap(void* data, size_t size)
+	{
+#if !defined(_WIN32)
+		munmap(data, size);
+#else
+		(void)data;
+		(void)size;
+#endif
+	}
+
+	inline SharedControl* Shared::open(const std::string& name, bool write, bool create)
+	{
+#if !defined(_WIN32)
+		const std::string file = control(name);
+
+		int fd = create ? shm_open(file.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600) : -1;
+
+		if (fd < 0 && (!create || errno == EEXIST))
+			fd = shm_open(file.c_str(), write ? O_RDWR : O_RDONLY, 0);
+
+		if (fd < 0) return nullptr;
+
+		struct stat st;
+
+		bool good = fstat(fd, &st) == 0;
+
+		if (good && write) // Not one created by another user to read or steer the publisher
+			good = st.st_uid == geteuid() && ((st.st_mode & 077) == 0 || fchmod(fd, 0600) == 0);
+
+		if (good && st.st_size < static_cast<off_t>(sizeof(SharedControl)))
+			good = create && ftruncate(fd, sizeof(SharedControl)) == 0; // Zero filled: no version yet
+
+		void* data = good ? mmap(nullptr, sizeof(SharedControl), write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+
+		::close(fd);
+
+		return data == MAP_FAILED ? nullptr : static_cast<SharedControl*>(data);
+#else
+		(void)name;
+		(void)write;
+		(void)create;
+
+		return nullptr;
+#endif
+	}
+
+	inline bool Shared::publish(const std::string& name, Load& load, uint64_t* version)
+	{
+		return publish(name, to_binary(load), version);
+	}
+
+	inline bool Shared::publish(const std::string& name, const std::string& cache, uint64_t* version)
+	{
+#if !defined(_WIN32)
+		SharedControl* state = open(name, true, true);
+
+		if (!state) return false;
+
+		const uint64_t mine = state->next.fetch_add(1) + 1;
+
+		const std::string file = segment(name, mine);
+
+		const SharedHeader header = { { 'M', 'T', 'L', 'M' }, BINARY_VERSION, mine, cache.size(), 64 };
+
+		const size_t size = static_cast<size_t>(header.offset) + cache.size();
+
+		const int fd = shm_open(file.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+		void* data = MAP_FAILED;
+
+		if (fd >= 0)
+		{
+			if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+				data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+			::close(fd);
+		}
+
+		if (data == MAP_FAILED)
+		{
+			if (fd >= 0) shm_unlink(file.c_str());
+
+			close(state);
+
+			return false;
+		}
+
+		std::memcpy(data, &header, sizeof header);
+		std::memcpy(static_cast<char*>(data) + header.offset, cache.data(), cache.size());
+
+		unmap(data, size);
+
+		uint64_t before = state->current.load();
+
+		while (before < mine && !state->current.compare_exchange_weak(before, mine)) {}
+
+		if (before < mine)
+		{
+			if (before) shm_unlink(segment(name, before).c_str());
+		}
+		else
+			shm_unlink(file.c_str()); // A newer version was published meanwhile
+
+		close(state);
+
+		if (version) *version = mine;
+
+		return before < mine;
+#else
+		(void)name;
+		(void)cache;
+		(void)version;
+
+		return false;
+#endif
+	}
+
+	inline bool Shared::remove(const std::string& name)
+	{
+#if !defined(_WIN32)
+		SharedControl* state = open(name, true);
+
+		if (state)
+		{
+			const uint64_t published = state->current.exchange(0);
+
+			if (published) shm_unlink(segment(name, published).c_str());
+
+			close(state);
+		}
+
+		return shm_unlink(control(name).c_str()) == 0;
+#else
+		(void)name;
+
+		return false;
+#endif
+	}
+
+	inline bool Shared::attach(const std::string& name)
+	{
+		detach();
+
+#if !defined(_WIN32)
+		SharedControl* state = open(name, false);
+
+		if (!state) return false;
+
+		for (int attempt = 0; attempt < 8 && !map; attempt++) // Retry if the version is replaced before it is opened
+		{
+			const uint64_t published = state->current.load();
+
+			if (!published) break;
+
+			const int fd = shm_open(segment(name, published).c_str(), O_RDONLY, 0);
+
+			if (fd < 0) continue;
+
+			struct stat st;
+
+			if (fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(SharedHeader)))
+			{
+				length = static_cast<size_t>(st.st_size);
+
+				map = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+
+				if (map == MAP_FAILED) map = nullptr;
+			}
+
+			::close(fd);
+
+			if (!map) continue;
+
+			SharedHeader header;
+
+			std::memcpy(&header, map, sizeof header);
+
+			const bool valid = std::memcmp(header.magic, "MTLM", 4) == 0 && header.binary == BINARY_VERSION && header.version == published &&
+				header.offset <= length && header.size <= length - header.offset;
+
+			if (valid && cache.open(static_cast<const char*>(map) + header.offset, static_cast<size_t>(header.size)))
+				current = published;
+			else
+				detach();
+
+			break;
+		}
+
+		close(state);
+
+		if (map) path = name;
+
+		return map != nullptr;
+#else
+		(void)name;
+
+		return false;
+#endif
+	}
+
+	inline void Shared::detach()
+	{
+		if (map) unmap(map, length);
+
+		map = nullptr;
+
+		length = 0;
+
+		current = 0;
+
+		path.clear();
+
+		cache = Binary();
+	}
+
+	inline bool Shared::stale() const
+	{
+		if (!map) return false;
+
+		SharedControl* state = open(path, false);
+
+		if (!state) return true; // Removed
+
+		const bool replaced = state->current.load() != current;
+
+		close(state);
+
+		return replaced;
+	}
+}
@@ -0,0 +1,346 @@
+/*
+  StreamMTL.h
+
+  C++ code solution for streaming materials from a Wavefront MTL file
+
+  Materials are parsed one at a time into a single reused Material, so memory
+  stays flat and the first material is available as soon as it is read.
+
+	for (auto& material : mtl::materials_of("library.mtl"))
+		process(material);
+
+  With C++ 20 coroutines materials_of returns a generator, otherwise it
+  returns a Stream with a plain input iterator. Both are used the same way.
+
+  As with Load, a statement that can not be parsed stops the stream; the
+  Stream then reports good() false and error() Error::parse. The generator
+  has error() as well, so a truncated library is told from a complete one:
+
+	auto materials = mtl::materials_of("library.mtl");
+
+	for (auto& material : materials)
+		process(material);
+
+	if (materials.error() != mtl::Error::none)
+		report(materials.error());
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "WavefrontMTL.h"
+
+#include <iterator>
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && __has_include(<coroutine>)
+#include <coroutine>
+#define WAVEFRONT_MTL_COROUTINE
+#endif
+
+namespace mtl
+{
+	class Stream
+	{
+	public:
+
+		class iterator
+		{
+		public:
+
+			typedef std::input_iterator_tag iterator_category;
+			typedef Material value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef Material* pointer;
+			typedef Material& reference;
+
+			iterator() : stream(nullptr) {}
+
+			explicit iterator(Stream* stream) : stream(stream) { ++*this; }
+
+			Material& operator*() const { return stream->material; }
+
+			Material* operator->() const { return &stream->material; }
+
+			iterator& operator++()
+			{
+				if (stream && !stream->next(stream->material))
+					stream = nullptr;
+
+				return *this;
+			}
+
+			bool operator==(const iterator& other) const { return stream == other.stream; }
+
+			bool operator!=(const iterator& other) const { return stream != other.stream; }
+
+		private:
+
+			Stream* stream;
+		};
+
+		explicit Stream(const std::string& path);
+
+		Stream(const std::string& path, const Material& defaults);
+
+		Stream(Stream&& other);
+
+		~Stream() { close(); }
+
+		Stream(const Stream&) = delete;
+
+		Stream& operator=(const Stream&) = delete;
+
+		Stream& operator=(Stream&&) = delete;
+
+		bool good() const { return file != nullptr || done; }
+
+		Error error() const { return status; }
+
+		bool extend(const std::string& keyword, Statement type);
+
+		bool next(Material& material);
+
+		iterator begin() { return iterator(this); }
+
+		iterator end() { return iterator(); }
+
+	private:
+
+		void close();
+
+		FILE* file;
+
+		Reader reader; // Line reader on file
+
+		Dispatch dispatch; // Keyword table for built-in and user registered statements
+
+		size_t custom; // Number of user registered statements
+
+		bool done; // End of file reached
+
+		Error status; // Reason the stream stopped before the end of file
+
+		Material blank; // Default values of each material
+
+		Material material; // Material buffer reused by the iterator
+
+		std::string pending; // Name of the next material, read by the last newmtl
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline Stream::Stream(const std::string& path) : file(fopen(path.c_str(), "rb")), reader(file), custom(0), done(false), status(file ? Error::none : Error::open) { }
+
+	inline Stream::Stream(const std::string& path, const Material& defaults) : Stream(path)
+	{
+		Parse::active = false;
+		blank = defaults;
+		Parse::active = true;
+	}
+
+	inline Stream::Stream(Stream&& other) : file(other.file), reader(std::move(other.reader)), dispatch(other.dispatch), custom(other.custom), done(other.done), status(other.status), blank(other.blank), pending(std::move(other.pending))
+	{
+		other.file = nullptr;
+	}
+
+	inline void Stream::close()
+	{
+		if (file) fclose(file);
+
+		file = nullptr;
+	}
+
+	inline bool Stream::extend(const std::string& keyword, Statement type)
+	{
+		if (keyword.empty() || keyword == "newmtl") return false;
+
+		if (!dispatch.add(keyword, parse_custom, type, custom))
+			return false;
+
+		custom++;
+
+		return true;
+	}
+
+	inline bool Stream::next(Material& m)
+	{
+		if (!file) return false;
+
+		m = blank;
+
+		if (!pending.empty())
+		{
+			m.name = pending;
+
+			pending.clear();
+		}
+
+		char* line;
+
+		char* args;
+
+		size_t length;
+
+		char buff[BUFFER_CHAR] = { 0 };
+
+		while (reader.next(buff, sizeof buff))
+		{
+			line = trim(buff);
+
+			if (*line == '#') continue;
+
+			if (!(args = split(line, length)))
+				continue;
+
+			if (length == 6 && char_cmp(line, "newmtl"))
+			{
+				if (!m.name.isParsed())
+				{
+					m.name = args;
+
+					continue;
+				}
+
+				pending = args;
+
+				return true;
+			}
+
+			const auto* keyword = dispatch.find(line, length);
+
+			if (keyword && !keyword->handler(args, m, *keyword))
+			{
+				close(); // As Load, a statement that can not be parsed ends the stream
+
+				status = Error::parse;
+
+				return false;
+			}
+		}
+
+		close();
+
+		done = true;
+
+		return m.name.isParsed();
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+#if defined(WAVEFRONT_MTL_COROUTINE)
+
+	class Generator
+	{
+	public:
+
+		struct promise_type
+		{
+			Material* current = nullptr;
+
+			Error status = Error::none; // Error of the stream, set when the generator ends
+
+			Generator get_return_object() { return Generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+			std::suspend_always initial_suspend() noexcept { return {}; }
+
+			std::suspend_always final_suspend() noexcept { return {}; }
+
+			std::suspend_always yield_value(Material& material) noexcept
+			{
+				current = &material;
+
+				return {};
+			}
+
+			void return_value(Error error) { status = error; }
+
+			void unhandled_exception() { throw; }
+		};
+
+		class iterator
+		{
+		public:
+
+			typedef std::input_iterator_tag iterator_category;
+			typedef Material value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef Material* pointer;
+			typedef Material& reference;
+
+			iterator() = default;
+
+			explicit iterator(std::coroutine_handle<promise_type> handle) : handle(handle) { ++*this; }
+
+			Material& operator*() const { return *handle.promise().current; }
+
+			Material* operator->() const { return handle.promise().current; }
+
+			iterator& operator++()
+			{
+				handle.resume();
+
+				if (handle.done())
+					handle = nullptr;
+
+				return *this;
+			}
+
+			bool operator==(const iterator& other) const { return handle == other.handle; }
+
+			bool operator!=(const iterator& other) const { return handle != other.handle; }
+
+		private:
+
+			std::coroutine_handle<promise_type> handle;
+		};
+
+		explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+		Generator(Generator&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+
+		~Generator() { if (handle) handle.destroy(); }
+
+		Generator(const Generator&) = delete;
+
+		Generator& operator=(const Generator&) = delete;
+
+		iterator begin() { return handle ? iterator(handle) : iterator(); }
+
+		iterator end() { return iterator(); }
+
+		Error error() const { return handle ? handle.promise().status : Error::none; }
+
+	private:
+
+		std::coroutine_handle<promise_type> handle;
+	};
+
+	inline Generator materials_of(std::string path)
+	{
+		Stream stream(path);
+
+		Material material;
+
+		while (stream.next(material))
+			co_yield material;
+
+		co_return stream.error();
+	}
+
+#else
+
+	inline Stream materials_of(const std::string& path)
+	{
+		return Stream(path);
+	}
+
+#endif
+}
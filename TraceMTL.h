@@ -17,6 +17,47 @@
 
 #include "WavefrontMTL.h"
 
+#if defined(WAVEFRONT_MTL_LIBRARY) && !defined(WAVEFRONT_MTL_IMPLEMENTATION)
+
+// Compiled library, the definitions are built in WavefrontMTL.cpp
+
+namespace mtl
+{
+	template <typename T>
+	void trace(const Value<T>& item, const bool end_line = true);
+
+	void trace(const std::string& label, const Value<bool>& item, const bool end_line = true);
+
+	template <typename T>
+	void trace(const std::string& label, const Value<T>& item, const bool end_line = true);
+
+	void trace(const std::string& label, const xyz& item, const bool end_line = true);
+
+	void trace(const std::string& label, const rgb& item, const bool end_line = true);
+
+	void trace(const std::string& label, const Model& item, const bool end_line = true);
+
+	void trace(const std::string& label, const uvw& item, const bool end_line = true);
+
+	void trace(const std::string& label, const Opacity& item);
+
+	void trace(const std::string& label, const Spectral& item);
+
+	void trace(const std::string& label, const Color& item);
+
+	void trace(const std::string& label, const Texture& item);
+
+	void trace(const std::string& label, const Reflection& item);
+
+	void trace(const Custom& item);
+
+	void trace(const Material& material);
+
+	void trace(Load& load);
+}
+
+#else
+
 #include <iostream>
 
 namespace mtl
@@ -31,7 +72,7 @@ namespace mtl
 		if( end_line ) std::cout << std::endl;
 	}
 
-	inline void trace(const std::string& label, const Value<bool>& item, const bool end_line = true)
+	MTL_INLINE void trace(const std::string& label, const Value<bool>& item, const bool end_line = true)
 	{
 		if( !item.isParsed() ) return;
 
@@ -55,7 +96,7 @@ namespace mtl
 		if( end_line ) std::cout << std::endl;
 	}
 
-	inline void trace(const std::string& label, const xyz& item, const bool end_line = true)
+	MTL_INLINE void trace(const std::string& label, const xyz& item, const bool end_line = true)
 	{
 		if( !item.isParsed() ) return;
 
@@ -64,7 +105,7 @@ namespace mtl
 		if( end_line ) std::cout << std::endl;
 	}
 
-	inline void trace(const std::string& label, const rgb& item, const bool end_line = true)
+	MTL_INLINE void trace(const std::string& label, const rgb& item, const bool end_line = true)
 	{
 		if( !item.isParsed() ) return;
 
@@ -73,7 +114,7 @@ namespace mtl
 		if( end_line ) std::cout << std::endl;
 	}
 
-	inline void trace(const std::string& label, const Model& item, const bool end_line = true)
+	MTL_INLINE void trace(const std::string& label, const Model& item, const bool end_line = true)
 	{
 		if( !item.isParsed() ) return;
 
@@ -82,7 +123,7 @@ namespace mtl
 		if( end_line ) std::cout << std::endl;
 	}
 
-	inline void trace(const std::string& label, const uvw& item, const bool end_line = true)
+	MTL_INLINE void trace(const std::string& label, const uvw& item, const bool end_line = true)
 	{
 		if( !item.isParsed() ) return;
 
@@ -91,7 +132,7 @@ namespace mtl
 		if( end_line ) std::cout << std::endl;
 	}
 
-	inline void trace(const std::string& label, const Opacity& item)
+	MTL_INLINE void trace(const std::string& label, const Opacity& item)
 	{
 		if( !item.isParsed() ) return;
 
@@ -102,14 +143,14 @@ namespace mtl
 		std::cout << " " << item.d << std::endl;
 	}
 
-	inline void trace(const std::string& label, const Spectral& item)
+	MTL_INLINE void trace(const std::string& label, const Spectral& item)
 	{
 		if( !item.isParsed() ) return;
 
 		std::cout << " " << label << " spectral " << item.file << " " << item.factor;
 	}
 
-	inline void trace(const std::string& label, const Color& item)
+	MTL_INLINE void trace(const std::string& label, const Color& item)
 	{
 		if( !item.isParsed() ) return;
 
@@ -118,7 +159,7 @@ namespace mtl
 		trace(label, item.spectral);
 	}
 
-	inline void trace(const std::string& label, const Texture& item)
+	MTL_INLINE void trace(const std::string& label, const Texture& item)
 	{
 		if( !item.isParsed() ) return;
 
@@ -140,7 +181,7 @@ namespace mtl
 		trace(item.file);
 	}
 
-	inline void trace(const std::string& label, const Reflection& item)
+	MTL_INLINE void trace(const std::string& label, const Reflection& item)
 	{
 		if( !item.isParsed() ) return;
 
@@ -155,7 +196,20 @@ namespace mtl
 		trace("cube_right", item.cube_right);
 	}
 
-	inline void trace(const Material& material)
+	MTL_INLINE void trace(const Custom& item)
+	{
+		if( !item.isParsed() ) return;
+
+		switch( item.type )
+		{
+		case Statement::color:   trace(item.keyword, item.color); break;
+		case Statement::scalar:  trace(item.keyword, item.scalar); break;
+		case Statement::texture: trace(item.keyword, item.texture); break;
+		case Statement::string:  trace(item.keyword, item.text); break;
+		}
+	}
+
+	MTL_INLINE void trace(const Material& material)
 	{
 		std::cout << std::endl;
 
@@ -197,9 +251,12 @@ namespace mtl
 		trace("norm", material.norm);
 		trace("map_RMA", material.map_RMA);
 		trace("map_ORM", material.map_ORM);
+
+		for( const auto& custom : material.custom )
+			trace(custom);
 	}
 
-	inline void trace(Load& load)
+	MTL_INLINE void trace(Load& load)
 	{
 		for( const auto& info : load.information() )
 			std::cout << " " << info << std::endl;
@@ -210,3 +267,5 @@ namespace mtl
 		std::cout << std::endl;
 	}
 }
+
+#endif
@@ -0,0 +1,444 @@
+/*
+  ViewMTL.h
+
+  C++ code solution for zero-copy access to Wavefront MTL files
+
+  The file is memory mapped (or taken from a caller owned buffer) and scanned
+  once. Each material only keeps its name and, for each statement, the keyword
+  id and a view of the arguments in the source buffer. Values are decoded into
+  a Material the first time they are asked for and then kept. Requires C++ 17.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "WavefrontMTL.h"
+
+#include <memory>
+#include <string_view>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace mtl
+{
+	class View;
+
+	struct Entry
+	{
+		size_t           id;   // Keyword id in Dispatch
+		std::string_view args; // Statement arguments in the source buffer
+	};
+
+	class MaterialView
+	{
+		friend class View;
+
+	public:
+
+		MaterialView() : view(nullptr), first(0), count(0) {}
+
+		MaterialView(const MaterialView& copy) : view(copy.view), label(copy.label), first(copy.first), count(copy.count) {}
+
+		MaterialView& operator=(const MaterialView& copy)
+		{
+			view = copy.view;
+			label = copy.label;
+			first = copy.first;
+			count = copy.count;
+			cache.reset();
+			decoded.clear();
+
+			return *this;
+		}
+
+		std::string_view name() const { return label; }
+
+		bool has(const std::string& keyword) const;
+
+		std::string_view arguments(const std::string& keyword) const;
+
+		const Material& decode(const std::string& keyword) const;
+
+		const Material& material() const;
+
+	private:
+
+		Material& storage() const;
+
+		bool decode(size_t entry) const;
+
+		const View* view;
+
+		std::string_view label; // Material name
+
+		size_t first; // First statement in View::entries
+
+		size_t count; // Number of statements
+
+		mutable std::unique_ptr<Material> cache; // Decoded values, allocated on first decode
+
+		mutable std::vector<bool> decoded; // Statements already decoded into cache
+	};
+
+	class View
+	{
+		friend class MaterialView;
+
+	public:
+
+		explicit View() : map(nullptr), length(0), custom(0) {}
+
+		~View() { close(); }
+
+		View(const View&) = delete;
+
+		View& operator=(const View&) = delete;
+
+		bool load(const std::string& path);
+
+		bool load(const char* data, size_t size);
+
+		bool extend(const std::string& keyword, Statement type);
+
+		std::vector<MaterialView>& materials() { return mtl; }
+
+		std::vector<std::string_view>& information() { return info; }
+
+		const MaterialView* find(const std::string& materialName) const;
+
+	private:
+
+		void scan(const char* data, size_t size);
+
+		void close();
+
+		void* map; // Mapped file
+
+		size_t length; // Size of mapped file
+
+		std::vector<char> buffer; // File content if mapping is not possible
+
+		Dispatch dispatch; // Keyword table shared with Load
+
+		size_t custom; // Number of user registered statements
+
+		std::vector<Entry> entries; // Statements of all materials
+
+		std::vector<MaterialView> mtl; // List of all materials found in file
+
+		std::vector<std::string_view> info; // List of all comment lines in the header of file
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline std::string_view trim(std::string_view text)
+	{
+		while (!text.empty() && std::isspace(text.front()))
+			text.remove_prefix(1);
+
+		while (!text.empty() && std::isspace(text.back()))
+			text.remove_suffix(1);
+
+		return text;
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline bool View::extend(const std::string& keyword, Statement type)
+	{
+		if (keyword.empty() || keyword == "newmtl") return false;
+
+		if (!dispatch.add(keyword, parse_custom, type, custom))
+			return false;
+
+		custom++;
+
+		return true;
+	}
+
+	inline void View::close()
+	{
+		entries.clear();
+
+		mtl.clear();
+
+		info.clear();
+
+		buffer.clear();
+
+#if !defined(_WIN32)
+		if (map) munmap(map, length);
+#endif
+		map = nullptr;
+
+		length = 0;
+	}
+
+	inline bool View::load(const std::string& path)
+	{
+		MTL_ZONE_TEXT("load", path.c_str());
+
+		close();
+
+#if !defined(_WIN32)
+		const int fd = open(path.c_str(), O_RDONLY);
+
+		if (fd < 0) return false;
+
+		struct stat st;
+
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+		{
+			length = static_cast<size_t>(st.st_size);
+
+			map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (map == MAP_FAILED)
+			{
+				map = nullptr;
+
+				length = 0;
+			}
+		}
+
+		::close(fd);
+
+		if (map)
+		{
+			scan(static_cast<const char*>(map), length);
+
+			return !mtl.empty();
+		}
+#endif
+
+		FILE* file = fopen(path.c_str(), "rb");
+
+		if (!file) return false;
+
+		char block[65536];
+
+		size_t read;
+
+		while ((read = fread(block, 1, sizeof block, file)) != 0)
+			buffer.insert(buffer.end(), block, block + read);
+
+		fclose(file);
+
+		scan(buffer.data(), buffer.size());
+
+		return !mtl.empty();
+	}
+
+	inline bool View::load(const char* data, size_t size)
+	{
+		close();
+
+		if (!data) return false;
+
+		scan(data, size);
+
+		return !mtl.empty();
+	}
+
+	inline void View::scan(const char* data, size_t size)
+	{
+		MTL_ZONE("index");
+
+		const char* p = data;
+
+		const char* end = data + size;
+
+		if (size >= 3 && std::memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+			p += 3;
+
+		while (p < end)
+		{
+			const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+
+			if (!eol) eol = end;
+
+			while (eol < end) // Line continuation
+			{
+				const char* last = eol;
+
+				while (last > p && (last[-1] == '\r'))
+					last--;
+
+				if (last == p || last[-1] != '\\')
+					break;
+
+				const char* next = static_cast<const char*>(std::memchr(eol + 1, '\n', end - eol - 1));
+
+				eol = next ? next : end;
+			}
+
+			const auto line = trim(std::string_view(p, eol - p));
+
+			p = eol + 1;
+
+			if (line.empty()) continue;
+
+			if (line.front() == '#')
+			{
+				if (mtl.empty())
+					info.emplace_back(trim(line.substr(1)));
+
+				continue;
+			}
+
+			size_t split(0);
+
+			while (split < line.size() && !std::isspace(line[split]))
+				split++;
+
+			if (split == line.size()) continue; // Statement without arguments
+
+			const auto keyword = line.substr(0, split);
+
+			const auto args = trim(line.substr(split));
+
+			if (keyword == "newmtl")
+			{
+				MaterialView material;
+
+				material.view = this;
+				material.label = args;
+				material.first = entries.size();
+
+				mtl.emplace_back(material);
+
+				continue;
+			}
+
+			if (mtl.empty()) continue;
+
+			const auto* found = dispatch.find(keyword.data(), keyword.size());
+
+			if (!found) continue;
+
+			entries.push_back({ found->id, args });
+
+			mtl.back().count++;
+		}
+	}
+
+	inline const MaterialView* View::find(const std::string& materialName) const
+	{
+		for (const auto& item : mtl)
+			if (item.label == materialName)
+				return &item;
+
+		return nullptr;
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline bool MaterialView::has(const std::string& keyword) const
+	{
+		return !arguments(keyword).empty();
+	}
+
+	inline std::string_view MaterialView::arguments(const std::string& keyword) const
+	{
+		const auto* found = view->dispatch.find(keyword.c_str(), keyword.length());
+
+		if (!found) return {};
+
+		for (size_t i = first + count; i-- > first;)
+			if (view->entries[i].id == found->id)
+				return view->entries[i].args;
+
+		return {};
+	}
+
+	inline Material& MaterialView::storage() const
+	{
+		if (!cache)
+		{
+			cache.reset(new Material);
+
+			cache->name = std::string(label);
+
+			decoded.assign(count, false);
+		}
+
+		return *cache;
+	}
+
+	inline bool MaterialView::decode(size_t entry) const
+	{
+		if (decoded[entry]) return true;
+
+		decoded[entry] = true;
+
+		const auto& item = view->entries[first + entry];
+
+		std::vector<char> line;
+
+		line.reserve(item.args.size() + 1);
+
+		for (size_t i = 0; i < item.args.size(); i++)
+		{
+			if (item.args[i] == '\\')
+			{
+				size_t j = i + 1;
+
+				while (j < item.args.size() && item.args[j] == '\r')
+					j++;
+
+				if (j < item.args.size() && item.args[j] == '\n')
+				{
+					line.push_back(' ');
+
+					i = j;
+
+					continue;
+				}
+			}
+
+			line.push_back(item.args[i]);
+		}
+
+		line.push_back('\0');
+
+		const auto& keyword = view->dispatch.keyword(item.id);
+
+		return keyword.handler(line.data(), storage(), keyword);
+	}
+
+	inline const Material& MaterialView::decode(const std::string& keyword) const
+	{
+		const auto* found = view->dispatch.find(keyword.c_str(), keyword.length());
+
+		auto& material = storage();
+
+		for (size_t i = 0; found && i < count; i++)
+			if (view->entries[first + i].id == found->id)
+				decode(i);
+
+		return material;
+	}
+
+	inline const Material& MaterialView::material() const
+	{
+		auto& material = storage();
+
+		for (size_t i = 0; i < count; i++)
+			decode(i);
+
+		return material;
+	}
+}
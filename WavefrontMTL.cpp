@@ -0,0 +1,57 @@
+/*
+  WavefrontMTL.cpp
+
+  Compiled library of the Wavefront MTL parser
+
+  Holds the definitions of WavefrontMTL.h and TraceMTL.h for projects that
+  define WAVEFRONT_MTL_LIBRARY. The headers then only declare the parser, so
+  includers do not compile the parser or include <iostream>. Value<T> and the
+  parse and trace templates are instantiated here for the types the parser
+  uses.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#ifndef WAVEFRONT_MTL_LIBRARY
+#define WAVEFRONT_MTL_LIBRARY
+#endif
+
+#define WAVEFRONT_MTL_IMPLEMENTATION
+
+#include "WavefrontMTL.h"
+#include "TraceMTL.h"
+
+namespace mtl
+{
+	bool Parse::active = true;
+
+	template struct Value<double>;
+	template struct Value<int>;
+	template struct Value<bool>;
+	template struct Value<char>;
+	template struct Value<std::string>;
+
+	template bool parse(char* line, Value<double>&, char*&);
+	template bool parse(char* line, Value<int>&, char*&);
+	template bool parse(char* line, Value<std::string>&, char*&);
+
+	template bool parse(char* line, Value<double>&);
+	template bool parse(char* line, Value<int>&);
+	template bool parse(char* line, Value<std::string>&);
+
+	template void trace(const Value<std::string>&, const bool);
+	template void trace(const Value<double>&, const bool);
+	template void trace(const Value<int>&, const bool);
+
+	template void trace(const std::string&, const Value<double>&, const bool);
+	template void trace(const std::string&, const Value<int>&, const bool);
+	template void trace(const std::string&, const Value<char>&, const bool);
+	template void trace(const std::string&, const Value<std::string>&, const bool);
+}
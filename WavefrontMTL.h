@@ -8,7 +8,9 @@
   The code provides comprehensive support for reading and parsing all known
   material parameters, including standard MTL parameters as well as additional
   parameters used in Clara.io and DirectXMesh. Runs for C++ 17. If you need
-  to run this for C++ 11, move line 152 to a cpp in your project.
+  to run this for C++ 11, or include it in many translation units, define
+  WAVEFRONT_MTL_LIBRARY and build WavefrontMTL.cpp as a library (see the
+  CMakeLists.txt); the header then only holds declarations.
 
   It allows for easy extraction of header information and materials,
   enabling access to material properties such as ambient color, diffuse color,
@@ -28,7 +30,9 @@
   - Supports parsing of Clara.io MTL parameters
   - Supports parsing of DirectXMesh MTL parameters
   - Retrieves header information and all materials in the MTL file
+  - Handles CRLF line endings, UTF-8 BOM and backslash line continuation
   - Provides convenient access to material properties
+  - Supports user registered statements (see Load::extend)
   - Robust and efficient parsing algorithm for handling large MTL files
   - Suitable for integration into 3D graphics applications, game engines,
 	and other computer graphics projects
@@ -50,14 +54,252 @@
 #ifndef WAVEFRONT_MTL
 #define WAVEFRONT_MTL
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <string>
 #include <vector>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <stdio.h>
 
+// Compiled library. Define WAVEFRONT_MTL_LIBRARY in all includers and build
+// WavefrontMTL.cpp once; the header then only declares the parser. Without
+// the define everything is inline (header-only).
+
+#if !defined(WAVEFRONT_MTL_LIBRARY) || defined(WAVEFRONT_MTL_IMPLEMENTATION)
+#define WAVEFRONT_MTL_DEFINITIONS
+#endif
+
+#if defined(WAVEFRONT_MTL_LIBRARY)
+#define MTL_INLINE
+#else
+#define MTL_INLINE inline
+#endif
+
+#ifdef WAVEFRONT_MTL_DEFINITIONS
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#endif
+
+// Profiler zones. Define WAVEFRONT_MTL_PROFILE to time the load phases through
+// mtl::profiler() hooks (see ProfileMTL.h), WAVEFRONT_MTL_PROFILE=2 to time
+// every line and statement as well. Define MTL_ZONE(name) before the include
+// to use an external profiler instead. Zones compile to nothing otherwise.
+
+#if defined(WAVEFRONT_MTL_PROFILE) && !defined(MTL_ZONE)
+#define WAVEFRONT_MTL_ZONES
+#define MTL_ZONE_JOIN(a, b) a##b
+#define MTL_ZONE_VARIABLE(line) MTL_ZONE_JOIN(mtl_zone_, line)
+#define MTL_ZONE_TEXT(name, text) mtl::Zone MTL_ZONE_VARIABLE(__LINE__)(name, text)
+#define MTL_ZONE(name) MTL_ZONE_TEXT(name, nullptr)
+#endif
+
+#ifndef MTL_ZONE
+#define MTL_ZONE(name)
+#endif
+
+#ifndef MTL_ZONE_TEXT
+#define MTL_ZONE_TEXT(name, text) MTL_ZONE(name)
+#endif
+
+#ifndef MTL_ZONE_DETAIL
+#if defined(WAVEFRONT_MTL_PROFILE) && (WAVEFRONT_MTL_PROFILE + 0) >= 2 // + 0 for an empty define
+#define MTL_ZONE_DETAIL(name) MTL_ZONE(name)
+#else
+#define MTL_ZONE_DETAIL(name)
+#endif
+#endif
+
 namespace mtl
 {
+#ifdef WAVEFRONT_MTL_ZONES
+	struct Profiler
+	{
+		void (*begin)(const char* name, const char* text, void* user); // Zone entered, text is optional
+		void (*end)(const char* name, void* user);                     // Zone left
+		void* user;                                                    // Passed to begin and end
+	};
+
+	// Hooks called by all zones, set them before loading
+
+	inline Profiler& profiler()
+	{
+		static Profiler hooks = { nullptr, nullptr, nullptr };
+
+		return hooks;
+	}
+
+	class Zone
+	{
+	public:
+
+		Zone(const char* name, const char* text) : name(name)
+		{
+			const auto& hooks = profiler();
+
+			if (hooks.begin) hooks.begin(name, text, hooks.user);
+		}
+
+		~Zone()
+		{
+			const auto& hooks = profiler();
+
+			if (hooks.end) hooks.end(name, hooks.user);
+		}
+
+		Zone(const Zone&) = delete;
+
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+
+		const char* name;
+	};
+#endif
+
 	struct Material;
 
+	struct Keyword;
+
+	enum class Statement { color, scalar, texture, string };
+
+	typedef bool (*Handler)(char* line, Material& material, const Keyword& keyword);
+
+	struct Keyword
+	{
+		std::string name;    // Statement keyword, e.g. "Kd" or "x_shader"
+		Handler     handler; // Parser for the statement arguments
+		Statement   type;    // Type of a user registered statement
+		size_t      slot;    // Index in Material::custom for a user registered statement
+		size_t      id;      // Index in Dispatch
+	};
+
+	class Dispatch
+	{
+	public:
+
+		explicit Dispatch();
+
+		bool add(const std::string& name, Handler handler, Statement type = Statement::string, size_t slot = 0);
+
+		const Keyword* find(const char* name, size_t length) const;
+
+		size_t size() const { return keywords.size(); }
+
+		const Keyword& keyword(size_t id) const { return keywords[id]; }
+
+	private:
+
+		static size_t hash(const char* name, size_t length);
+
+		void rehash(size_t size);
+
+		void insert(size_t id);
+
+		std::vector<Keyword> keywords; // All known statements, built-in first
+
+		std::vector<int> table; // Open addressing table of indices into keywords (-1 is empty)
+	};
+
+	enum class Error
+	{
+		none,        // No error
+		open,        // Impossible to open the file
+		parse,       // Statement could not be parsed
+		materials,   // Limits::materials exceeded
+		bytes,       // Limits::bytes exceeded
+		information, // Limits::information exceeded
+		string,      // Limits::string exceeded
+		memory,      // Limits::memory exceeded
+		cancelled    // Cancel::cancel called during load
+	};
+
+	struct Limits
+	{
+		Limits() : materials(0), bytes(0), information(0), string(0), memory(0) {}
+
+		size_t materials;   // Maximum number of materials (0 is unlimited)
+		size_t bytes;       // Maximum number of bytes read from file (0 is unlimited)
+		size_t information; // Maximum number of header comment lines (0 is unlimited)
+		size_t string;      // Maximum length of a line (0 is unlimited)
+		size_t memory;      // Maximum estimated memory for materials and strings (0 is unlimited)
+	};
+
+	class Cancel
+	{
+	public:
+
+		Cancel() : flag(false) {}
+
+		void cancel() { flag.store(true, std::memory_order_relaxed); }
+
+		void reset() { flag.store(false, std::memory_order_relaxed); }
+
+		bool cancelled() const { return flag.load(std::memory_order_relaxed); }
+
+	private:
+
+		std::atomic<bool> flag;
+	};
+
+	struct Progress
+	{
+		size_t bytes;     // Bytes read so far
+		size_t total;     // Size of file in bytes (0 if unknown)
+		size_t lines;     // Lines read so far
+		size_t materials; // Materials found so far
+	};
+
+	typedef std::function<void(const Progress&)> Report;
+
+	class Reader
+	{
+	public:
+
+		explicit Reader(FILE* file) : file(file), fd(-1), data(nullptr), pos(0), size(0), start(true), count(0) {}
+
+		explicit Reader(int fd) : file(nullptr), fd(fd), block(65536), data(block.data()), pos(0), size(0), start(true), count(0) {}
+
+		Reader(const char* data, size_t size) : file(nullptr), fd(-1), data(data), pos(0), size(size), start(true), count(0) {}
+
+		size_t next(char* buff, size_t length);
+
+		size_t bytes() const { return count; }
+
+	private:
+
+		size_t chunk(char* buff, size_t length);
+
+		bool fill();
+
+		FILE* file; // Stream source (fgets)
+
+		int fd; // Descriptor source that can not be mapped (pipe, socket)
+
+		std::vector<char> block; // Read buffer for descriptor source
+
+		const char* data; // Memory source, mapped file or block
+
+		size_t pos; // Read position in data
+
+		size_t size; // Size of data
+
+		bool start; // Nothing read yet (UTF-8 BOM check)
+
+		size_t count; // Bytes read from source
+	};
+
+	class Stream;
+
 	class Load
 	{
 	public:
@@ -78,14 +320,38 @@ namespace mtl
 
 		bool load(const std::string& path);
 
+		bool load(FILE* stream);
+
+		bool load(int fd);
+
+		bool load(const char* data, size_t size);
+
 		std::vector<Material>& materials() { return mtl; }
 
 		std::vector<std::string>& information() { return info; }
 
 		bool lookup(const std::string& materialName, Material& material) const;
 
+		bool extend(const std::string& keyword, Statement type);
+
+		void limit(const Limits& limits) { bounds = limits; }
+
+		Error error() const { return status; }
+
+		void cancellation(const Cancel* token) { cancel = token; }
+
+		void progress(const Report& callback, size_t lines = 4096) { report = callback; every = lines ? lines : 1; }
+
+		void linearize(bool enable = true) { linear = enable; }
+
 	private:
 
+		bool read(Reader& reader, size_t total);
+
+		bool checkpoint(size_t bytes, size_t total, size_t lines);
+
+		bool fail(Error error);
+
 		Material default_material() const;
 
 		bool open(const std::string& open_path);
@@ -94,6 +360,24 @@ namespace mtl
 
 		FILE* file;
 
+		bool owner; // File is opened by Load and closed by close()
+
+		Dispatch dispatch; // Keyword table for built-in and user registered statements
+
+		size_t custom; // Number of user registered statements
+
+		Limits bounds; // Resource limits for untrusted files
+
+		Error status; // Error of the last load
+
+		const Cancel* cancel; // Token checked while loading (optional)
+
+		Report report; // Progress callback (optional)
+
+		size_t every; // Lines between each cancel check and progress report
+
+		bool linear; // Convert colors from sRGB to linear after load
+
 		std::string path; // Material file 	
 
 		std::vector<Material> mtl; // List of all materials found in file
@@ -105,6 +389,8 @@ namespace mtl
 	{
 		friend class Load;
 
+		friend class Stream;
+
 		Parse() : parse(false) { }
 
 		Parse& operator=(const Parse& copy)
@@ -132,7 +418,9 @@ namespace mtl
 		static bool active;
 	};
 
+#ifndef WAVEFRONT_MTL_LIBRARY
 	inline bool Parse::active = true; //This declaration is legal for C++ 17 (move this line to a cpp in your project if C++ 11)
+#endif
 
 	template <typename T>
 	struct Value : Parse
@@ -157,6 +445,14 @@ namespace mtl
 		T value;
 	};
 
+#ifdef WAVEFRONT_MTL_LIBRARY
+	extern template struct Value<double>;
+	extern template struct Value<int>;
+	extern template struct Value<bool>;
+	extern template struct Value<char>;
+	extern template struct Value<std::string>;
+#endif
+
 	struct uvw : Parse
 	{
 		uvw() : u(0), v(0), w(0) { }
@@ -168,15 +464,18 @@ namespace mtl
 		double w; // Texture coordinate w mapping [0..1]
 	};
 
+	enum class Encoding { srgb, linear };
+
 	struct rgb : Parse
 	{
-		rgb() : r(0), g(0), b(0) { }
+		rgb() : r(0), g(0), b(0), encoding(Encoding::srgb) { }
 
-		rgb(const double& r, const double& g, const double& b) : r(r), g(g), b(b) { }
+		rgb(const double& r, const double& g, const double& b, Encoding encoding = Encoding::srgb) : r(r), g(g), b(b), encoding(encoding) { }
 
-		double r; // Ambient color red   [0..1]
-		double g; // Ambient color green [0..1]
-		double b; // Ambient color blue  [0..1]
+		double   r;        // Ambient color red   [0..1]
+		double   g;        // Ambient color green [0..1]
+		double   b;        // Ambient color blue  [0..1]
+		Encoding encoding; // sRGB as in the file, linear after Load::linearize
 	};
 
 	struct xyz : Parse
@@ -258,6 +557,18 @@ namespace mtl
 		Texture cube_right;  // Reflection texture map
 	};
 
+	struct Custom : Parse
+	{
+		Custom() : type(Statement::string) {}
+
+		std::string        keyword; // User registered keyword
+		Statement          type;    // Parser used for the arguments
+		Color              color;   // Parsed value if type is Statement::color
+		Value<double>      scalar;  // Parsed value if type is Statement::scalar
+		Texture            texture; // Parsed value if type is Statement::texture
+		Value<std::string> text;    // Parsed value if type is Statement::string
+	};
+
 	//-------------------------------------------------------------------------------------------------------
 
 	struct Material
@@ -301,14 +612,105 @@ namespace mtl
 		Texture            norm;      // Texture Normal				(Physically Rendering/Clara.io)
 		Texture            map_RMA;   // Texture RMA				(DirectXMesh/Microsoft's DirectX engine)
 		Texture            map_ORM;   // Texture ORM				(DirectXMesh/Microsoft's DirectX engine)
+		std::vector<Custom> custom;   // User registered statements	(see Load::extend)
+
+		const Custom* extension(const std::string& keyword) const
+		{
+			for (const auto& item : custom)
+				if (item.isParsed() && item.keyword == keyword)
+					return &item;
+
+			return nullptr;
+		}
 	};
 
 	//-------------------------------------------------------------------------------------------------------
 
+	// Calls visitor(keyword, field) for every statement field of a material, in declaration order.
+	// M is Material or const Material. Used by the writers and readers of other formats.
+
+	template <typename M, typename Visitor>
+	void visit(M& m, Visitor&& visitor)
+	{
+		visitor("Kd", m.Kd);
+		visitor("Ka", m.Ka);
+		visitor("Ks", m.Ks);
+		visitor("Tf", m.Tf);
+		visitor("Ns", m.Ns);
+		visitor("map_Kd", m.map_Kd);
+		visitor("map_Ka", m.map_Ka);
+		visitor("map_Ks", m.map_Ks);
+		visitor("map_Ns", m.map_Ns);
+		visitor("map_Pr", m.map_Pr);
+		visitor("map_Pm", m.map_Pm);
+		visitor("map_Ps", m.map_Ps);
+		visitor("map_d", m.map_d);
+		visitor("map_bump", m.map_bump);
+		visitor("map_Po", m.map_Po);
+		visitor("sharpness", m.sharpness);
+		visitor("d", m.d);
+		visitor("disp", m.disp);
+		visitor("decal", m.decal);
+		visitor("bump", m.bump);
+		visitor("illum", m.illum);
+		visitor("Ni", m.Ni);
+		visitor("Tr", m.Tr);
+		visitor("refl", m.refl);
+		visitor("Ke", m.Ke);
+		visitor("Pr", m.Pr);
+		visitor("Pm", m.Pm);
+		visitor("Ps", m.Ps);
+		visitor("Pc", m.Pc);
+		visitor("Pcr", m.Pcr);
+		visitor("aniso", m.aniso);
+		visitor("anisor", m.anisor);
+		visitor("map_Ke", m.map_Ke);
+		visitor("norm", m.norm);
+		visitor("map_RMA", m.map_RMA);
+		visitor("map_ORM", m.map_ORM);
+	}
+
+	// Calls visitor(option, field) for every option of a texture, file excluded.
+
+	template <typename T, typename Visitor>
+	void visit_options(T& t, Visitor&& visitor)
+	{
+		visitor("blendu", t.blendu);
+		visitor("blendv", t.blendv);
+		visitor("clamp", t.clamp);
+		visitor("cc", t.cc);
+		visitor("bm", t.bm);
+		visitor("boost", t.boost);
+		visitor("texres", t.texres);
+		visitor("mm", t.mm);
+		visitor("o", t.o);
+		visitor("s", t.s);
+		visitor("t", t.t);
+		visitor("imfchan", t.imfchan);
+	}
+
+	// Calls visitor(type, texture) for every texture of a reflection map.
+
+	template <typename R, typename Visitor>
+	void visit_reflection(R& r, Visitor&& visitor)
+	{
+		visitor("sphere", r.sphere);
+		visitor("cube_top", r.cube_top);
+		visitor("cube_bottom", r.cube_bottom);
+		visitor("cube_front", r.cube_front);
+		visitor("cube_back", r.cube_back);
+		visitor("cube_left", r.cube_left);
+		visitor("cube_right", r.cube_right);
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
 	constexpr int BUFFER_CHAR = 1000;
 
 	char* trim(char*);
 
+	char* split(char* line, size_t& length);
+
 	template <typename T>
 	bool parse(char* line, Value<T>&);
 
@@ -325,25 +727,37 @@ namespace mtl
 
 	bool char_cmp(const char*, const std::string&);
 
+	bool parse_custom(char* line, Material&, const Keyword&);
+
+	double srgb_to_linear(double c);
+
+	void linearize(std::vector<Material>& materials);
+
 	//-------------------------------------------------------------------------------------------------------
 
-	inline Load::Load() : file(nullptr) { }
+#ifdef WAVEFRONT_MTL_DEFINITIONS
+
+	MTL_INLINE Load::Load() : file(nullptr), owner(false), custom(0), status(Error::none), cancel(nullptr), every(4096), linear(false) { }
 
-	inline Load::Load(const Material& material) : Load()
+	MTL_INLINE Load::Load(const Material& material) : Load()
 	{
 		mtl.emplace_back(material);
 	}
 
-	inline Load::~Load() { close(); }
+	MTL_INLINE Load::~Load() { close(); }
 
-	inline bool Load::open(const std::string& open_path)
+	MTL_INLINE bool Load::open(const std::string& open_path)
 	{
+		MTL_ZONE("open");
+
 		close();
 
 		path = open_path;
 
 		file = fopen(path.c_str(), "rb");
 
+		owner = true;
+
 		if (file) return true;
 
 		printf("Impossible to open mtl the file !\n");
@@ -351,16 +765,33 @@ namespace mtl
 		return false;
 	}
 
-	inline void Load::close()
+	MTL_INLINE bool Load::fail(Error error)
+	{
+		close();
+
+		status = error;
+
+		return false;
+	}
+
+	MTL_INLINE bool Load::checkpoint(size_t bytes, size_t total, size_t lines)
+	{
+		if (report)
+			report({ bytes, total, lines, mtl.front().name.isParsed() ? mtl.size() : 0 });
+
+		return !(cancel && cancel->cancelled());
+	}
+
+	MTL_INLINE void Load::close()
 	{
 		if (!file) return;
 
-		fclose(file);
+		if (owner) fclose(file);
 
 		file = nullptr;
 	}
 
-	inline bool Load::lookup(const std::string& materialName, Material& material) const
+	MTL_INLINE bool Load::lookup(const std::string& materialName, Material& material) const
 	{
 		for (const auto& item : mtl)
 		{
@@ -375,7 +806,19 @@ namespace mtl
 		return false;
 	}
 
-	inline Material Load::default_material() const
+	MTL_INLINE bool Load::extend(const std::string& keyword, Statement type)
+	{
+		if (keyword.empty() || keyword == "newmtl") return false;
+
+		if (!dispatch.add(keyword, parse_custom, type, custom))
+			return false;
+
+		custom++;
+
+		return true;
+	}
+
+	MTL_INLINE Material Load::default_material() const
 	{
 		Material material;
 
@@ -388,10 +831,121 @@ namespace mtl
 		return material;
 	}
 
-	inline bool Load::load(const std::string& path)
+	MTL_INLINE bool Load::load(const std::string& path)
 	{
+		MTL_ZONE_TEXT("load", path.c_str());
+
+		status = Error::none;
+
 		if (!open(path))
-			return false;
+			return fail(Error::open);
+
+		size_t total(0);
+
+		if (report && fseek(file, 0, SEEK_END) == 0)
+		{
+			const long end = ftell(file);
+
+			total = end > 0 ? static_cast<size_t>(end) : 0;
+
+			rewind(file);
+		}
+
+		Reader reader(file);
+
+		return read(reader, total);
+	}
+
+	MTL_INLINE bool Load::load(FILE* stream)
+	{
+		close();
+
+		status = Error::none;
+
+		if (!stream)
+			return fail(Error::open);
+
+		file = stream;
+
+		owner = false;
+
+		size_t total(0);
+
+		const long start = report ? ftell(file) : -1;
+
+		if (start >= 0 && fseek(file, 0, SEEK_END) == 0)
+		{
+			const long end = ftell(file);
+
+			total = end > start ? static_cast<size_t>(end - start) : 0;
+
+			fseek(file, start, SEEK_SET);
+		}
+
+		Reader reader(file);
+
+		return read(reader, total);
+	}
+
+	MTL_INLINE bool Load::load(const char* data, size_t size)
+	{
+		close();
+
+		status = Error::none;
+
+		if (!data)
+			return fail(Error::open);
+
+		Reader reader(data, size);
+
+		return read(reader, size);
+	}
+
+	MTL_INLINE bool Load::load(int fd)
+	{
+		close();
+
+		status = Error::none;
+
+		if (fd < 0)
+			return fail(Error::open);
+
+#if !defined(_WIN32)
+		struct stat st;
+
+		const off_t offset = lseek(fd, 0, SEEK_CUR); // Read from the current offset, as pipes and FILE* are
+
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && offset >= 0 && st.st_size > offset)
+		{
+			const off_t start = offset - offset % static_cast<off_t>(sysconf(_SC_PAGESIZE)); // mmap offsets are page aligned
+
+			const size_t size = static_cast<size_t>(st.st_size - start);
+
+			void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, start);
+
+			if (map != MAP_FAILED)
+			{
+				madvise(map, size, MADV_SEQUENTIAL);
+
+				const bool result = load(static_cast<const char*>(map) + (offset - start), size - static_cast<size_t>(offset - start));
+
+				munmap(map, size);
+
+				lseek(fd, st.st_size, SEEK_SET); // Consumed as by read
+
+				return result;
+			}
+		}
+#endif
+
+		Reader reader(fd);
+
+		return read(reader, 0);
+	}
+
+	MTL_INLINE bool Load::read(Reader& reader, size_t total)
+	{
+		MTL_ZONE("parse");
 
 		Material material = default_material();
 
@@ -403,114 +957,256 @@ namespace mtl
 
 		char* line;
 
-		std::string text;
+		char* args;
 
 		bool proceed(true);
 
+		bool partial(false); // Last read stopped before end of line
+
+		size_t size(0);   // Length of the current line so far
+
+		size_t bytes(0);  // Bytes read from file
+
+		size_t memory(sizeof(Material)); // Estimated memory of parsed data
+
+		size_t lines(0); // Lines read from file
+
+		size_t countdown(every); // Lines until next checkpoint
+
+		size_t length(0); // Length of text in buff
+
 		char buff[BUFFER_CHAR] = { 0 };
 
-		while (fgets(buff, sizeof buff, file))
+		while ((length = reader.next(buff, sizeof buff)) != 0)
 		{
+			lines++;
+
+			if (--countdown == 0)
+			{
+				countdown = every;
+
+				if (!checkpoint(bytes, total, lines))
+					return fail(Error::cancelled);
+			}
+
+			size = partial ? size + length : length;
+
+			partial = length != 0 && buff[length - 1] != '\n'; // A line of NUL bytes reads as empty
+
+			bytes = reader.bytes();
+
+			memory += length;
+
+			if (bounds.bytes && bytes > bounds.bytes)
+				return fail(Error::bytes);
+
+			if (bounds.string && size > bounds.string)
+				return fail(Error::string);
+
+			if (bounds.memory && memory > bounds.memory)
+				return fail(Error::memory);
+
 			line = trim(buff);
 
 			auto& m = mtl.back();
 
 			if (*line == '#')
 			{
-				if (!m.name.isParsed())
-					info.emplace_back(trim(line + 1));
+				if (m.name.isParsed()) continue;
+
+				if (bounds.information && info.size() == bounds.information)
+					return fail(Error::information);
+
+				memory += sizeof(std::string);
+
+				info.emplace_back(trim(line + 1));
+
+				continue;
+			}
+
+			size_t keyword_length(0);
+
+			{
+				MTL_ZONE_DETAIL("tokenize");
+
+				args = split(line, keyword_length);
 			}
-			else if (char_cmp(line, "newmtl"))
+
+			if (!args)
+				continue; // Statement without arguments
+
+			if (keyword_length == 6 && char_cmp(line, "newmtl"))
 			{
 				if (m.name.isParsed())
+				{
+					if (bounds.materials && mtl.size() == bounds.materials)
+						return fail(Error::materials);
+
+					memory += sizeof(Material);
+
+					if (bounds.memory && memory > bounds.memory)
+						return fail(Error::memory);
+
 					mtl.emplace_back(material);
+				}
+
+				mtl.back().name = args;
 
-				mtl.back().name = trim(line + 7);
+				continue;
 			}
-			else if (char_cmp(line, "Kd "))
-				proceed = parse(line + 3, m.Kd);
-			else if (char_cmp(line, "Ka "))
-				proceed = parse(line + 3, m.Ka);
-			else if (char_cmp(line, "Ks "))
-				proceed = parse(line + 3, m.Ks);
-			else if (char_cmp(line, "Tf "))
-				proceed = parse(line + 3, m.Tf);
-			else if (char_cmp(line, "Ns "))
-				proceed = parse(line + 3, m.Ns);
-			else if (char_cmp(line, "map_Kd "))
-				proceed = parse(line + 7, m.map_Kd);
-			else if (char_cmp(line, "map_Ka "))
-				proceed = parse(line + 7, m.map_Ka);
-			else if (char_cmp(line, "map_Ks "))
-				proceed = parse(line + 7, m.map_Ks);
-			else if (char_cmp(line, "map_Ns "))
-				proceed = parse(line + 7, m.map_Ns);
-			else if (char_cmp(line, "map_Pr "))
-				proceed = parse(line + 7, m.map_Pr);
-			else if (char_cmp(line, "map_Pm "))
-				proceed = parse(line + 7, m.map_Pm);
-			else if (char_cmp(line, "map_Ps "))
-				proceed = parse(line + 7, m.map_Ps);
-			else if (char_cmp(line, "map_d "))
-				proceed = parse(line + 6, m.map_d);
-			else if (char_cmp(line, "map_bump "))
-				proceed = parse(line + 9, m.map_bump);
-			else if (char_cmp(line, "map_Po "))
-				proceed = parse(line + 7, m.map_Po);
-			else if (char_cmp(line, "sharpness "))
-				proceed = parse(line + 10, m.sharpness);
-			else if (char_cmp(line, "d "))
-				proceed = parse(line + 2, m.d);
-			else if (char_cmp(line, "disp "))
-				proceed = parse(line + 5, m.disp);
-			else if (char_cmp(line, "decal "))
-				proceed = parse(line + 6, m.decal);
-			else if (char_cmp(line, "bump "))
-				proceed = parse(line + 5, m.bump);
-			else if (char_cmp(line, "illum "))
-				proceed = parse(line + 6, m.illum);
-			else if (char_cmp(line, "Ni "))
-				proceed = parse(line + 3, m.Ni);
-			else if (char_cmp(line, "Tr "))
-				proceed = parse(line + 3, m.Tr);
-			else if (char_cmp(line, "refl "))
-				proceed = parse(line + 5, m.refl);
-			else if (char_cmp(line, "Ke "))
-				proceed = parse(line + 3, m.Ke);
-			else if (char_cmp(line, "Pr "))
-				proceed = parse(line + 3, m.Pr);
-			else if (char_cmp(line, "Pm "))
-				proceed = parse(line + 3, m.Pm);
-			else if (char_cmp(line, "Ps "))
-				proceed = parse(line + 3, m.Ps);
-			else if (char_cmp(line, "Pc "))
-				proceed = parse(line + 3, m.Pc);
-			else if (char_cmp(line, "Pcr "))
-				proceed = parse(line + 4, m.Pcr);
-			else if (char_cmp(line, "aniso "))
-				proceed = parse(line + 6, m.aniso);
-			else if (char_cmp(line, "anisor "))
-				proceed = parse(line + 7, m.anisor);
-			else if (char_cmp(line, "map_Ke "))
-				proceed = parse(line + 7, m.map_Ke);
-			else if (char_cmp(line, "norm "))
-				proceed = parse(line + 5, m.norm);
-			else if (char_cmp(line, "map_RMA "))
-				proceed = parse(line + 8, m.map_RMA);
-			else if (char_cmp(line, "map_ORM "))
-				proceed = parse(line + 8, m.map_ORM);
-
-			if (!proceed) return false;
+
+			{
+				MTL_ZONE_DETAIL("dispatch");
+
+				const auto* keyword = dispatch.find(line, keyword_length);
+
+				if (keyword)
+					proceed = keyword->handler(args, m, *keyword);
+			}
+
+			if (!proceed) return fail(Error::parse);
 		}
 
 		close();
 
+		checkpoint(bytes, total, lines); // Final report, the file is read to the end so the load is not cancelled
+
+		if (linear)
+			mtl::linearize(mtl);
+
 		return mtl.front().name.isParsed();
 	}
 
 	//-------------------------------------------------------------------------------------------------------
 
-	inline std::string strtoword(char* text, char*& end)
+	MTL_INLINE bool Reader::fill()
+	{
+		if (fd < 0) return false;
+
+		for (;;)
+		{
+#if defined(_WIN32)
+			const int count = _read(fd, block.data(), static_cast<unsigned int>(block.size()));
+#else
+			const ssize_t count = ::read(fd, block.data(), block.size());
+
+			if (count < 0 && errno == EINTR) continue;
+#endif
+			if (count <= 0) return false;
+
+			pos = 0;
+
+			size = static_cast<size_t>(count);
+
+			return true;
+		}
+	}
+
+	MTL_INLINE size_t Reader::next(char* buff, size_t length)
+	{
+		MTL_ZONE_DETAIL("read"); // Every line of every source: FILE*, descriptor and memory
+
+		size_t n(0);
+
+		while (n < length - 1)
+		{
+			size_t read = chunk(buff + n, length - n);
+
+			if (read == 0) break;
+
+			count += read;
+
+			if (start)
+			{
+				start = false;
+
+				if (read >= 3 && std::memcmp(buff, "\xEF\xBB\xBF", 3) == 0)
+				{
+					std::memmove(buff, buff + 3, read - 2);
+
+					read -= 3;
+
+					if (read == 0) continue;
+				}
+			}
+
+			n += read;
+
+			if (buff[n - 1] != '\n') break; // Line continues in next chunk or end of file
+
+			if (n > 1 && buff[n - 2] == '\r')
+			{
+				buff[n - 2] = '\n';
+				buff[--n] = '\0';
+			}
+
+			if (n < 2 || buff[n - 2] != '\\') break;
+
+			buff[n - 2] = ' '; // Line continuation, join with next line
+
+			buff[--n] = '\0';
+		}
+
+		return n;
+	}
+
+	MTL_INLINE size_t Reader::chunk(char* buff, size_t length)
+	{
+		if (file)
+		{
+			// fgets does not tell how much it read, strlen does unless the line holds
+			// NUL bytes. Then the read filled the buffer (the last byte is set before),
+			// reached the end of file, or stopped at the first '\n' past the NUL.
+
+			buff[length - 1] = '\n';
+
+			if (!fgets(buff, static_cast<int>(length), file)) return 0;
+
+			const size_t n = std::strlen(buff);
+
+			if ((n && buff[n - 1] == '\n') || n == length - 1) return n;
+
+			if (buff[length - 1] == '\0') return length - 1;
+
+			if (feof(file) || ferror(file)) return n;
+
+			const auto* eol = static_cast<const char*>(std::memchr(buff + n, '\n', length - 1 - n));
+
+			return eol ? eol - buff + 1 : n;
+		}
+
+		size_t n(0);
+
+		while (n < length - 1)
+		{
+			if (pos == size && !fill())
+				break;
+
+			const char* from = data + pos;
+
+			const size_t count = std::min(length - 1 - n, size - pos);
+
+			const auto* eol = static_cast<const char*>(std::memchr(from, '\n', count));
+
+			const size_t take = eol ? eol - from + 1 : count;
+
+			std::memcpy(buff + n, from, take);
+
+			n += take;
+
+			pos += take;
+
+			if (eol) break;
+		}
+
+		buff[n] = '\0';
+
+		return n;
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	MTL_INLINE std::string strtoword(char* text, char*& end)
 	{
 		end = text;
 
@@ -543,7 +1239,7 @@ namespace mtl
 
 	//-------------------------------------------------------------------------------------------------------
 
-	inline bool parse(char* line, std::string& s, char*& end)
+	MTL_INLINE bool parse(char* line, std::string& s, char*& end)
 	{
 		if (line == nullptr) return false;
 
@@ -552,7 +1248,7 @@ namespace mtl
 		return true;
 	}
 
-	inline bool parse(const char* line, int& i, char*& end)
+	MTL_INLINE bool parse(const char* line, int& i, char*& end)
 	{
 		if (line == nullptr) return false;
 
@@ -561,7 +1257,7 @@ namespace mtl
 		return true;
 	}
 
-	inline bool parse(const char* line, double& d, char*& end)
+	MTL_INLINE bool parse(const char* line, double& d, char*& end)
 	{
 		if (line == nullptr) return false;
 
@@ -570,7 +1266,7 @@ namespace mtl
 		return true;
 	}
 
-	inline bool parse(char* line, uvw& uvw, char*& end)
+	MTL_INLINE bool parse(char* line, uvw& uvw, char*& end)
 	{
 		uvw.parsed(false);
 
@@ -594,10 +1290,12 @@ namespace mtl
 		return true;
 	}
 
-	inline bool parse(char* line, rgb& rgb, char*& end)
+	MTL_INLINE bool parse(char* line, rgb& rgb, char*& end)
 	{
 		rgb.parsed(false);
 
+		rgb.encoding = Encoding::srgb; // As written in the file, the target may be a linearized default
+
 		if (!parse(line, rgb.r, line))
 			return false;
 
@@ -618,7 +1316,7 @@ namespace mtl
 		return true;
 	}
 
-	inline bool parse(char* line, xyz& xyz, char*& end)
+	MTL_INLINE bool parse(char* line, xyz& xyz, char*& end)
 	{
 		xyz.parsed(false);
 
@@ -642,7 +1340,7 @@ namespace mtl
 		return true;
 	}
 
-	inline bool parse(char* line, Model& mm, char*& end)
+	MTL_INLINE bool parse(char* line, Model& mm, char*& end)
 	{
 		mm.parsed(false);
 
@@ -657,7 +1355,7 @@ namespace mtl
 		return true;
 	}
 
-	inline bool parse(char* line, Spectral& spectral, char*& end)
+	MTL_INLINE bool parse(char* line, Spectral& spectral, char*& end)
 	{
 		spectral.parsed(false);
 
@@ -672,7 +1370,7 @@ namespace mtl
 		return true;
 	}
 
-	inline bool parse(char* line, Color& color, char*& end)
+	MTL_INLINE bool parse(char* line, Color& color, char*& end)
 	{
 		if (char_cmp(line, "spectral "))
 			return color.parsed(parse(line + 9, color.spectral, end));
@@ -683,12 +1381,12 @@ namespace mtl
 		return color.parsed(parse(line, color.color, end));
 	}
 
-	inline bool parse(char* line, Color& color)
+	MTL_INLINE bool parse(char* line, Color& color)
 	{
 		return parse(line, color, line);
 	}
 
-	inline bool parse(char* line, Opacity& opacity, char*& end)
+	MTL_INLINE bool parse(char* line, Opacity& opacity, char*& end)
 	{
 		opacity.parsed(false);
 
@@ -716,13 +1414,15 @@ namespace mtl
 		return opacity.parsed(parse(line, opacity.d, end));
 	}
 
-	inline bool parse(char* line, Opacity& opacity)
+	MTL_INLINE bool parse(char* line, Opacity& opacity)
 	{
 		return parse(line, opacity, line);
 	}
 
-	inline bool parse(char* line, Texture& texture, char*& end)
+	MTL_INLINE bool parse(char* line, Texture& texture, char*& end)
 	{
+		MTL_ZONE_DETAIL("texture");
+
 		auto* p = line;
 
 		std::string temp;
@@ -879,12 +1579,12 @@ namespace mtl
 		return texture.parsed(isParsed);
 	}
 
-	inline bool parse(char* line, Texture& texture)
+	MTL_INLINE bool parse(char* line, Texture& texture)
 	{
 		return parse(line, texture, line);
 	}
 
-	inline bool parse(char* line, Reflection& reflection)
+	MTL_INLINE bool parse(char* line, Reflection& reflection)
 	{
 		reflection.parsed(false);
 
@@ -956,7 +1656,213 @@ namespace mtl
 
 	//-------------------------------------------------------------------------------------------------------
 
-	inline bool char_cmp(const char* a, const char* b, const size_t length)
+	MTL_INLINE bool parse_custom(char* line, Material& material, const Keyword& keyword)
+	{
+		if (material.custom.size() <= keyword.slot)
+			material.custom.resize(keyword.slot + 1);
+
+		auto& custom = material.custom[keyword.slot];
+
+		custom.keyword = keyword.name;
+		custom.type = keyword.type;
+
+		switch (keyword.type)
+		{
+		case Statement::color:
+			return custom.parsed(parse(line, custom.color));
+		case Statement::scalar:
+			return custom.parsed(parse(line, custom.scalar));
+		case Statement::texture:
+			return custom.parsed(parse(line, custom.texture));
+		case Statement::string:
+			custom.text = line;
+			return custom.parsed(true);
+		}
+
+		return false;
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	MTL_INLINE double srgb_to_linear(double c)
+	{
+		return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+	}
+
+	// Converts all sRGB colors (Kd, Ka, Ks, Ke, Tf and user registered colors) to linear in one
+	// pass over a packed array. The loop has no branches, so compilers can vectorize it
+	// (GCC and Clang with -O3 -ffast-math call the vector pow of libmvec or SVML).
+
+	MTL_INLINE void linearize(std::vector<Material>& materials)
+	{
+		std::vector<rgb*> colors;
+
+		colors.reserve(materials.size() * 5);
+
+		auto add = [&](Color& item)
+		{
+			if (item.color.isParsed() && item.color.encoding == Encoding::srgb)
+				colors.push_back(&item.color);
+		};
+
+		for (auto& material : materials)
+		{
+			add(material.Kd);
+			add(material.Ka);
+			add(material.Ks);
+			add(material.Ke);
+			add(material.Tf);
+
+			for (auto& item : material.custom)
+				if (item.isParsed() && item.type == Statement::color)
+					add(item.color);
+		}
+
+		std::vector<double> values(colors.size() * 3);
+
+		for (size_t i = 0; i < colors.size(); i++)
+		{
+			values[i * 3 + 0] = colors[i]->r;
+			values[i * 3 + 1] = colors[i]->g;
+			values[i * 3 + 2] = colors[i]->b;
+		}
+
+		double* v = values.data();
+
+		const size_t count = values.size();
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const double c = v[i];
+
+			const double low = c / 12.92;
+
+			const double high = std::pow((std::max(c, 0.04045) + 0.055) / 1.055, 2.4);
+
+			v[i] = c <= 0.04045 ? low : high;
+		}
+
+		for (size_t i = 0; i < colors.size(); i++)
+		{
+			colors[i]->r = values[i * 3 + 0];
+			colors[i]->g = values[i * 3 + 1];
+			colors[i]->b = values[i * 3 + 2];
+			colors[i]->encoding = Encoding::linear;
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	MTL_INLINE Dispatch::Dispatch() : table(128, -1)
+	{
+		add("Kd", [](char* l, Material& m, const Keyword&) { return parse(l, m.Kd); });
+		add("Ka", [](char* l, Material& m, const Keyword&) { return parse(l, m.Ka); });
+		add("Ks", [](char* l, Material& m, const Keyword&) { return parse(l, m.Ks); });
+		add("Tf", [](char* l, Material& m, const Keyword&) { return parse(l, m.Tf); });
+		add("Ns", [](char* l, Material& m, const Keyword&) { return parse(l, m.Ns); });
+		add("map_Kd", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_Kd); });
+		add("map_Ka", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_Ka); });
+		add("map_Ks", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_Ks); });
+		add("map_Ns", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_Ns); });
+		add("map_Pr", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_Pr); });
+		add("map_Pm", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_Pm); });
+		add("map_Ps", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_Ps); });
+		add("map_d", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_d); });
+		add("map_bump", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_bump); });
+		add("map_Po", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_Po); });
+		add("sharpness", [](char* l, Material& m, const Keyword&) { return parse(l, m.sharpness); });
+		add("d", [](char* l, Material& m, const Keyword&) { return parse(l, m.d); });
+		add("disp", [](char* l, Material& m, const Keyword&) { return parse(l, m.disp); });
+		add("decal", [](char* l, Material& m, const Keyword&) { return parse(l, m.decal); });
+		add("bump", [](char* l, Material& m, const Keyword&) { return parse(l, m.bump); });
+		add("illum", [](char* l, Material& m, const Keyword&) { return parse(l, m.illum); });
+		add("Ni", [](char* l, Material& m, const Keyword&) { return parse(l, m.Ni); });
+		add("Tr", [](char* l, Material& m, const Keyword&) { return parse(l, m.Tr); });
+		add("refl", [](char* l, Material& m, const Keyword&) { return parse(l, m.refl); });
+		add("Ke", [](char* l, Material& m, const Keyword&) { return parse(l, m.Ke); });
+		add("Pr", [](char* l, Material& m, const Keyword&) { return parse(l, m.Pr); });
+		add("Pm", [](char* l, Material& m, const Keyword&) { return parse(l, m.Pm); });
+		add("Ps", [](char* l, Material& m, const Keyword&) { return parse(l, m.Ps); });
+		add("Pc", [](char* l, Material& m, const Keyword&) { return parse(l, m.Pc); });
+		add("Pcr", [](char* l, Material& m, const Keyword&) { return parse(l, m.Pcr); });
+		add("aniso", [](char* l, Material& m, const Keyword&) { return parse(l, m.aniso); });
+		add("anisor", [](char* l, Material& m, const Keyword&) { return parse(l, m.anisor); });
+		add("map_Ke", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_Ke); });
+		add("norm", [](char* l, Material& m, const Keyword&) { return parse(l, m.norm); });
+		add("map_RMA", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_RMA); });
+		add("map_ORM", [](char* l, Material& m, const Keyword&) { return parse(l, m.map_ORM); });
+	}
+
+	MTL_INLINE size_t Dispatch::hash(const char* name, size_t length)
+	{
+		size_t h(2166136261u); // FNV-1a
+
+		for (size_t i = 0; i < length; i++)
+			h = (h ^ static_cast<unsigned char>(name[i])) * 16777619u;
+
+		return h;
+	}
+
+	MTL_INLINE void Dispatch::rehash(size_t size)
+	{
+		table.assign(size, -1);
+
+		for (size_t i = 0; i < keywords.size(); i++)
+			insert(i);
+	}
+
+	MTL_INLINE void Dispatch::insert(size_t id)
+	{
+		const auto& name = keywords[id].name;
+
+		const size_t mask = table.size() - 1;
+
+		size_t n = hash(name.c_str(), name.length()) & mask;
+
+		while (table[n] != -1)
+			n = (n + 1) & mask;
+
+		table[n] = static_cast<int>(id);
+	}
+
+	MTL_INLINE bool Dispatch::add(const std::string& name, Handler handler, Statement type, size_t slot)
+	{
+		if (name.empty() || handler == nullptr) return false;
+
+		if (find(name.c_str(), name.length())) return false;
+
+		keywords.push_back({ name, handler, type, slot, keywords.size() });
+
+		if (keywords.size() * 2 > table.size())
+			rehash(table.size() * 2); // Grows at half load, the new keyword is inserted with the others
+		else
+			insert(keywords.size() - 1);
+
+		return true;
+	}
+
+	MTL_INLINE const Keyword* Dispatch::find(const char* name, size_t length) const
+	{
+		const size_t mask = table.size() - 1;
+
+		size_t n = hash(name, length) & mask;
+
+		while (table[n] != -1)
+		{
+			const auto& keyword = keywords[table[n]];
+
+			if (keyword.name.length() == length && std::memcmp(keyword.name.c_str(), name, length) == 0)
+				return &keyword;
+
+			n = (n + 1) & mask;
+		}
+
+		return nullptr;
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	MTL_INLINE bool char_cmp(const char* a, const char* b, const size_t length)
 	{
 		if (length == 0) return false;
 		if (a == nullptr) return false;
@@ -983,12 +1889,29 @@ namespace mtl
 		return n == length;
 	}
 
-	inline bool char_cmp(const char* a, const std::string& b)
+	MTL_INLINE bool char_cmp(const char* a, const std::string& b)
 	{
 		return char_cmp(a, b.c_str(), b.length());
 	}
 
-	inline char* trim(char* p)
+	MTL_INLINE char* split(char* line, size_t& length)
+	{
+		char* args = line;
+
+		while (*args != '\0' && !std::isspace(*args))
+			args++;
+
+		if (*args == '\0') return nullptr;
+
+		length = args - line;
+
+		while (std::isspace(*args))
+			args++;
+
+		return args;
+	}
+
+	MTL_INLINE char* trim(char* p)
 	{
 		if (p == nullptr) return nullptr;
 
@@ -1008,6 +1931,8 @@ namespace mtl
 
 		return p;
 	}
+
+#endif // WAVEFRONT_MTL_DEFINITIONS
 }
 
 #endif // WAVEFRONT_MTL
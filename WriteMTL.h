@@ -0,0 +1,320 @@
+/*
+  WriteMTL.h
+
+  C++ code solution for writing Wavefront MTL text
+
+  Writes a loaded library back as MTL text that WavefrontMTL reads to the same
+  values. Only values that are parsed (see isParsed) are written, header
+  information as leading comments. Numbers are written with std::to_chars
+  (shortest round trip). The -cc and -texres options are not written, the
+  parser does not read them.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#pragma once
+
+#include "WavefrontMTL.h"
+
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+
+namespace mtl
+{
+	class TextWriter
+	{
+	public:
+
+		explicit TextWriter(FILE* sink = nullptr) : sink(sink), good(true) { buffer.reserve(1 << 16); }
+
+		std::string& str() { return buffer; }
+
+		bool flush();
+
+		void material(const Material& material);
+
+		void comment(const std::string& text) { buffer += "# "; buffer += text; buffer += '\n'; }
+
+	private:
+
+		void number(double value);
+
+		void number(int value) { number(static_cast<double>(value)); }
+
+		void word(const char* text) { buffer += ' '; buffer += text; }
+
+		void statement(const char* keyword, const Value<double>& item);
+
+		void statement(const char* keyword, const Value<int>& item);
+
+		void statement(const char* keyword, const Value<std::string>& item);
+
+		void statement(const char* keyword, const Color& item);
+
+		void statement(const char* keyword, const Opacity& item);
+
+		void statement(const char* keyword, const Texture& item);
+
+		void statement(const char* keyword, const Reflection& item);
+
+		void texture(const Texture& item);
+
+		FILE* sink; // Flush target (optional)
+
+		bool good; // All flushes succeeded
+
+		std::string buffer;
+	};
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline bool TextWriter::flush()
+	{
+		if (!sink) return good;
+
+		if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), sink) != buffer.size())
+			good = false;
+
+		buffer.clear();
+
+		return good;
+	}
+
+	inline void TextWriter::number(double value)
+	{
+		char text[32];
+
+		buffer += ' ';
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+		const auto result = std::to_chars(text, text + sizeof text, value);
+
+		buffer.append(text, result.ptr);
+#else
+		buffer.append(text, snprintf(text, sizeof text, "%.17g", value));
+#endif
+	}
+
+	inline void TextWriter::statement(const char* keyword, const Value<double>& item)
+	{
+		if (!item.isParsed()) return;
+
+		buffer += keyword;
+		number(item.value);
+		buffer += '\n';
+	}
+
+	inline void TextWriter::statement(const char* keyword, const Value<int>& item)
+	{
+		if (!item.isParsed()) return;
+
+		buffer += keyword;
+		number(item.value);
+		buffer += '\n';
+	}
+
+	inline void TextWriter::statement(const char* keyword, const Value<std::string>& item)
+	{
+		if (!item.isParsed()) return;
+
+		buffer += keyword;
+		word(item.value.c_str());
+		buffer += '\n';
+	}
+
+	inline void TextWriter::statement(const char* keyword, const Color& item)
+	{
+		if (!item.isParsed()) return;
+
+		buffer += keyword;
+
+		if (item.spectral.isParsed())
+		{
+			word("spectral");
+			word(item.spectral.file.c_str());
+			number(item.spectral.factor);
+		}
+		else if (item.color_space.isParsed())
+		{
+			word("xyz");
+			number(item.color_space.x);
+			number(item.color_space.y);
+			number(item.color_space.z);
+		}
+		else
+		{
+			number(item.color.r);
+			number(item.color.g);
+			number(item.color.b);
+		}
+
+		buffer += '\n';
+	}
+
+	inline void TextWriter::statement(const char* keyword, const Opacity& item)
+	{
+		if (!item.isParsed()) return;
+
+		buffer += keyword;
+
+		if (item.halo)
+			word("-halo");
+
+		number(item.d);
+		buffer += '\n';
+	}
+
+	inline void TextWriter::texture(const Texture& item)
+	{
+		auto on = [&](const char* option, const Value<bool>& value)
+		{
+			if (!value.isParsed()) return;
+
+			word(option);
+			word(value.value ? "on" : "off");
+		};
+
+		auto coordinate = [&](const char* option, const uvw& value)
+		{
+			if (!value.isParsed()) return;
+
+			word(option);
+			number(value.u);
+			number(value.v);
+			number(value.w);
+		};
+
+		on("-blendu", item.blendu);
+		on("-blendv", item.blendv);
+		on("-clamp", item.clamp);
+
+		if (item.bm.isParsed())
+		{
+			word("-bm");
+			number(item.bm.value);
+		}
+
+		if (item.boost.isParsed())
+		{
+			word("-boost");
+			number(item.boost.value);
+		}
+
+		if (item.mm.isParsed())
+		{
+			word("-mm");
+			number(item.mm.base);
+			number(item.mm.gain);
+		}
+
+		coordinate("-o", item.o);
+		coordinate("-s", item.s);
+		coordinate("-t", item.t);
+
+		if (item.imfchan.isParsed())
+		{
+			const char channel[] = { item.imfchan.value, '\0' };
+
+			word("-imfchan");
+			word(channel);
+		}
+
+		if (item.file.isParsed())
+			word(item.file.value.c_str());
+	}
+
+	inline void TextWriter::statement(const char* keyword, const Texture& item)
+	{
+		if (!item.isParsed()) return;
+
+		buffer += keyword;
+		texture(item);
+		buffer += '\n';
+	}
+
+	inline void TextWriter::statement(const char* keyword, const Reflection& item)
+	{
+		if (!item.isParsed()) return;
+
+		visit_reflection(item, [&](const char* type, const Texture& cube)
+		{
+			if (!cube.isParsed()) return;
+
+			buffer += keyword;
+			word("-type");
+			word(type);
+			texture(cube);
+			buffer += '\n';
+		});
+	}
+
+	inline void TextWriter::material(const Material& material)
+	{
+		if (!material.name.isParsed()) return;
+
+		statement("newmtl", material.name);
+
+		visit(material, [&](const char* keyword, const auto& item) { statement(keyword, item); });
+
+		for (const auto& item : material.custom)
+		{
+			if (!item.isParsed()) continue;
+
+			switch (item.type)
+			{
+			case Statement::color:   statement(item.keyword.c_str(), item.color); break;
+			case Statement::scalar:  statement(item.keyword.c_str(), item.scalar); break;
+			case Statement::texture: statement(item.keyword.c_str(), item.texture); break;
+			case Statement::string:  statement(item.keyword.c_str(), item.text); break;
+			}
+		}
+
+		buffer += '\n';
+	}
+
+	//-------------------------------------------------------------------------------------------------------
+
+	inline void to_mtl(Load& load, TextWriter& out)
+	{
+		for (const auto& line : load.information())
+			out.comment(line);
+
+		if (!load.information().empty())
+			out.str() += '\n';
+
+		for (const auto& material : load.materials())
+		{
+			out.material(material);
+
+			out.flush();
+		}
+	}
+
+	inline std::string to_mtl(Load& load)
+	{
+		TextWriter out;
+
+		to_mtl(load, out);
+
+		return std::move(out.str());
+	}
+
+	inline bool to_mtl(Load& load, FILE* stream)
+	{
+		if (!stream) return false;
+
+		TextWriter out(stream);
+
+		to_mtl(load, out);
+
+		return out.flush();
+	}
+}
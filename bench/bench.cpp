@@ -0,0 +1,609 @@
+/*
+  bench.cpp
+
+  Benchmarks of the Wavefront MTL parser
+
+	bench [--json] [-n iterations] [scenario ...]
+
+  Each scenario runs its body a number of times after one warm up run. The
+  wall time and, on Linux, the hardware counters cycles, instructions, branch
+  misses, L1 data cache read misses and last level cache misses are read
+  around the timed runs and reported per run. Counters that can not be opened
+  (no perf_event support, perf_event_paranoid, virtual machines) are reported
+  as n/a and the benchmark still runs.
+
+  Allocations are counted, so the number of allocations, allocated bytes and
+  the peak heap above the start of a scenario are reported as well. With
+  glibc, malloc, calloc, realloc, free and the aligned allocators are
+  replaced and forward to glibc, so allocations made directly with malloc or
+  by the C library (strdup, stdio buffers) are counted along with operator
+  new, which goes through malloc. Elsewhere only global operator new and
+  delete are replaced and direct malloc calls are not counted. Allocations per material and per statement
+  are checked against the limits of each scenario; a scenario over its limit
+  is reported as a regression and the exit code is 1.
+
+	load_small    Load::load of a single material from memory
+	load_large    Load::load of 10000 materials from memory
+	load_file     Load::load of 10000 materials from a file
+	lookup        Load::lookup of every material by name
+	trace         mtl::trace of 1000 materials to a null stream
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#include "../WavefrontMTL.h"
+#include "../TraceMTL.h"
+#include "../JsonMTL.h"
+
+#include <chrono>
+#include <new>
+#include <sstream>
+
+#if defined(__GLIBC__)
+#include <cerrno>
+#include <malloc.h>
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+extern "C" void* __libc_memalign(size_t align, size_t size);
+extern "C" void  __libc_free(void* p);
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+	// Heap usage of the process, updated by the allocators below
+
+	struct Heap
+	{
+		std::atomic<uint64_t> allocations{ 0 };
+		std::atomic<uint64_t> bytes{ 0 };
+		std::atomic<int64_t>  current{ 0 };
+		std::atomic<int64_t>  peak{ 0 };
+	};
+
+	Heap heap;
+
+	constexpr size_t HEADER = 16; // Size of an allocation, keeps malloc alignment
+
+	void add(size_t size, int64_t resident)
+	{
+		heap.allocations.fetch_add(1, std::memory_order_relaxed);
+		heap.bytes.fetch_add(size, std::memory_order_relaxed);
+
+		const int64_t current = heap.current.fetch_add(resident, std::memory_order_relaxed) + resident;
+
+		int64_t peak = heap.peak.load(std::memory_order_relaxed);
+
+		while (current > peak && !heap.peak.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {}
+	}
+
+#if defined(__GLIBC__)
+
+	// Resident size is the usable size of the block, the same on allocation and release
+
+	void* counted(void* p, size_t size)
+	{
+		if (p) add(size, static_cast<int64_t>(malloc_usable_size(p)));
+
+		return p;
+	}
+
+	void uncounted(void* p)
+	{
+		if (p) heap.current.fetch_sub(static_cast<int64_t>(malloc_usable_size(p)), std::memory_order_relaxed);
+	}
+
+	void* allocate(size_t size, size_t align = HEADER)
+	{
+		return align > HEADER ? memalign(align, size) : malloc(size);
+	}
+
+	void release(void* p, size_t = HEADER)
+	{
+		free(p);
+	}
+
+#else
+
+	void* allocate(size_t size, size_t align = HEADER)
+	{
+		const size_t header = std::max(align, HEADER);
+
+		char* raw = static_cast<char*>(align > HEADER ? aligned_alloc(align, (size + 2 * header - 1) / align * align) : malloc(size + header));
+
+		if (!raw) return nullptr;
+
+		char* p = raw + header;
+
+		std::memcpy(p - sizeof size, &size, sizeof size);
+
+		add(size, static_cast<int64_t>(size));
+
+		return p;
+	}
+
+	void release(void* p, size_t align = HEADER)
+	{
+		if (!p) return;
+
+		size_t size;
+
+		std::memcpy(&size, static_cast<char*>(p) - sizeof size, sizeof size);
+
+		heap.current.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+
+		free(static_cast<char*>(p) - std::max(align, HEADER));
+	}
+
+#endif
+
+	void* allocate_or_throw(size_t size, size_t align = HEADER)
+	{
+		void* p = allocate(size, align);
+
+		if (!p) throw std::bad_alloc();
+
+		return p;
+	}
+}
+
+#if defined(__GLIBC__)
+
+extern "C"
+{
+	void* malloc(size_t size) noexcept { return counted(__libc_malloc(size), size); }
+
+	void* calloc(size_t count, size_t size) noexcept { return counted(__libc_calloc(count, size), count * size); }
+
+	void* realloc(void* p, size_t size) noexcept
+	{
+		if (!p) return malloc(size);
+
+		if (size == 0)
+		{
+			free(p);
+
+			return nullptr;
+		}
+
+		const size_t before = malloc_usable_size(p);
+
+		void* q = __libc_realloc(p, size);
+
+		if (q)
+		{
+			heap.current.fetch_sub(static_cast<int64_t>(before), std::memory_order_relaxed);
+
+			counted(q, size);
+		}
+
+		return q;
+	}
+
+	void* memalign(size_t align, size_t size) noexcept { return counted(__libc_memalign(align, size), size); }
+
+	void* aligned_alloc(size_t align, size_t size) noexcept { return memalign(align, size); }
+
+	int posix_memalign(void** p, size_t align, size_t size) noexcept
+	{
+		if (align < sizeof(void*) || (align & (align - 1)) != 0) return EINVAL;
+
+		*p = memalign(align, size);
+
+		return *p || size == 0 ? 0 : ENOMEM;
+	}
+
+	void free(void* p) noexcept
+	{
+		uncounted(p);
+
+		__libc_free(p);
+	}
+}
+
+#endif
+
+void* operator new(size_t size) { return allocate_or_throw(size); }
+void* operator new[](size_t size) { return allocate_or_throw(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(size_t size, std::align_val_t align) { return allocate_or_throw(size, static_cast<size_t>(align)); }
+void* operator new[](size_t size, std::align_val_t align) { return allocate_or_throw(size, static_cast<size_t>(align)); }
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t align) noexcept { release(p, static_cast<size_t>(align)); }
+void operator delete[](void* p, std::align_val_t align) noexcept { release(p, static_cast<size_t>(align)); }
+void operator delete(void* p, size_t, std::align_val_t align) noexcept { release(p, static_cast<size_t>(align)); }
+void operator delete[](void* p, size_t, std::align_val_t align) noexcept { release(p, static_cast<size_t>(align)); }
+
+namespace
+{
+	constexpr int COUNTERS = 5;
+
+	const char* counter_names[COUNTERS] = { "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses" };
+
+	// Hardware counters of the calling thread, each opened on its own so that
+	// a counter the CPU or kernel does not offer only disables that counter.
+
+	class Counters
+	{
+	public:
+
+		Counters()
+		{
+			for (auto& fd : fds)
+				fd = -1;
+#ifdef __linux__
+			const uint32_t types[COUNTERS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE };
+
+			const uint64_t configs[COUNTERS] = {
+				PERF_COUNT_HW_CPU_CYCLES,
+				PERF_COUNT_HW_INSTRUCTIONS,
+				PERF_COUNT_HW_BRANCH_MISSES,
+				PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+				PERF_COUNT_HW_CACHE_MISSES };
+
+			for (int i = 0; i < COUNTERS; i++)
+			{
+				perf_event_attr attr;
+
+				std::memset(&attr, 0, sizeof attr);
+
+				attr.size = sizeof attr;
+				attr.type = types[i];
+				attr.config = configs[i];
+				attr.disabled = 1;
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+
+				fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+			}
+#endif
+		}
+
+		~Counters()
+		{
+			for (const int fd : fds)
+				if (fd >= 0) close(fd);
+		}
+
+		bool available() const
+		{
+			for (const int fd : fds)
+				if (fd >= 0) return true;
+
+			return false;
+		}
+
+		void start()
+		{
+#ifdef __linux__
+			for (const int fd : fds)
+			{
+				if (fd < 0) continue;
+
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+#endif
+		}
+
+		// Stops the counters, values of counters that are not available are -1
+
+		void stop(int64_t* values)
+		{
+			for (int i = 0; i < COUNTERS; i++)
+			{
+				values[i] = -1;
+#ifdef __linux__
+				if (fds[i] < 0) continue;
+
+				ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+				uint64_t count;
+
+				if (read(fds[i], &count, sizeof count) == sizeof count)
+					values[i] = static_cast<int64_t>(count);
+#endif
+			}
+		}
+
+	private:
+
+		int fds[COUNTERS];
+	};
+
+	struct Scenario
+	{
+		const char*           name;
+		size_t                items;      // Materials handled by one run
+		size_t                statements; // Statements handled by one run, 0 if none are parsed
+		size_t                scale;      // Runs are multiplied by scale
+		double                material;   // Limit of allocations per material
+		double                statement;  // Limit of allocations per statement
+		std::function<void()> run;
+	};
+
+	struct Result
+	{
+		const char* name;
+		size_t      runs;
+		size_t      items;
+		size_t      statements;
+		double      ns;                 // Wall time per run
+		int64_t     counters[COUNTERS]; // Total over all runs, -1 if not available
+		double      allocations;        // Allocations per run
+		double      bytes;              // Allocated bytes per run
+		int64_t     peak;               // Peak heap above the start of the scenario
+		bool        regression;         // Allocations over the limits of the scenario
+	};
+
+	constexpr size_t STATEMENTS = 9; // Statements per material in library()
+
+	// Synthetic library with the statement mix of exported DCC libraries
+
+	std::string library(size_t materials)
+	{
+		std::string text = "# Benchmark library\n";
+
+		char line[256];
+
+		for (size_t i = 0; i < materials; i++)
+		{
+			snprintf(line, sizeof line,
+				"newmtl material_%zu\n"
+				"Ka 0.0435 0.0435 0.0435\n"
+				"Kd 0.%04zu 0.1086 0.1086\n"
+				"Ks 0.5 0.5 0.5\n"
+				"Ns 10.0000\n"
+				"d 1.0\n"
+				"illum 2\n"
+				"map_Kd -s 1 1 1 -o 0 0 0 -mm 0 1 diffuse_%zu.png\n"
+				"map_bump -bm 1 normal_%zu.png\n\n", i, i % 10000, i % 64, i % 64);
+
+			text += line;
+		}
+
+		return text;
+	}
+
+	Result measure(const Scenario& scenario, size_t runs, Counters& counters)
+	{
+		scenario.run();
+
+		Result result{ scenario.name, runs, scenario.items, scenario.statements, 0, {}, 0, 0, 0, false };
+
+		const uint64_t allocations = heap.allocations.load();
+
+		const uint64_t bytes = heap.bytes.load();
+
+		const int64_t current = heap.current.load();
+
+		heap.peak.store(current);
+
+		const auto start = std::chrono::steady_clock::now();
+
+		counters.start();
+
+		for (size_t i = 0; i < runs; i++)
+			scenario.run();
+
+		counters.stop(result.counters);
+
+		result.ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / runs;
+
+		result.allocations = static_cast<double>(heap.allocations.load() - allocations) / runs;
+
+		result.bytes = static_cast<double>(heap.bytes.load() - bytes) / runs;
+
+		result.peak = heap.peak.load() - current;
+
+		if (scenario.material > 0 && result.allocations / scenario.items > scenario.material)
+			result.regression = true;
+
+		if (scenario.statement > 0 && scenario.statements && result.allocations / scenario.statements > scenario.statement)
+			result.regression = true;
+
+		return result;
+	}
+
+	void print(const Result& result)
+	{
+		printf("%-12s %12.0f ns %10.1f ns/material", result.name, result.ns, result.ns / result.items);
+
+		for (int i = 0; i < COUNTERS; i++)
+		{
+			if (result.counters[i] < 0)
+				printf("  %s n/a", counter_names[i]);
+			else
+				printf("  %s %.0f", counter_names[i], static_cast<double>(result.counters[i]) / result.runs);
+		}
+
+		if (result.counters[0] > 0 && result.counters[1] >= 0)
+			printf("  ipc %.2f", static_cast<double>(result.counters[1]) / result.counters[0]);
+
+		printf("\n%-12s %12.0f allocations %10.2f /material", "", result.allocations, result.allocations / result.items);
+
+		if (result.statements)
+			printf(" %8.2f /statement", result.allocations / result.statements);
+
+		printf("  %.0f bytes  peak %lld bytes%s\n", result.bytes, static_cast<long long>(result.peak), result.regression ? "  REGRESSION" : "");
+	}
+
+	void print(const Result& result, mtl::JsonWriter& out)
+	{
+		out.open('{');
+		out.key("name");
+		out.string(result.name);
+		out.key("runs");
+		out.number(static_cast<double>(result.runs));
+		out.key("ns");
+		out.number(result.ns);
+		out.key("ns_per_material");
+		out.number(result.ns / result.items);
+
+		for (int i = 0; i < COUNTERS; i++)
+		{
+			if (result.counters[i] < 0) continue;
+
+			out.key(counter_names[i]);
+			out.number(static_cast<double>(result.counters[i]) / result.runs);
+		}
+
+		out.key("allocations");
+		out.number(result.allocations);
+		out.key("allocations_per_material");
+		out.number(result.allocations / result.items);
+
+		if (result.statements)
+		{
+			out.key("allocations_per_statement");
+			out.number(result.allocations / result.statements);
+		}
+
+		out.key("bytes");
+		out.number(result.bytes);
+		out.key("peak");
+		out.number(static_cast<double>(result.peak));
+		out.key("regression");
+		out.boolean(result.regression);
+
+		out.close('}');
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool json(false);
+
+	size_t runs(20);
+
+	std::vector<std::string> filter;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--json")
+			json = true;
+		else if (arg == "-n" && i + 1 < argc)
+			runs = std::max(1, atoi(argv[++i]));
+		else
+			filter.push_back(arg);
+	}
+
+	const std::string small = library(1);
+
+	const std::string large = library(10000);
+
+	const std::string path = "bench_library.mtl";
+
+	FILE* file = fopen(path.c_str(), "wb");
+
+	if (file)
+	{
+		fwrite(large.data(), 1, large.size(), file);
+		fclose(file);
+	}
+
+	mtl::Load loaded;
+
+	loaded.load(large.data(), large.size());
+
+	const std::string medium = library(1000);
+
+	mtl::Load traced;
+
+	traced.load(medium.data(), medium.size());
+
+	std::ostringstream sink;
+
+	const std::vector<Scenario> scenarios = {
+		{ "load_small", 1, STATEMENTS, 100, 16, 2, [&]() { mtl::Load load; load.load(small.data(), small.size()); } },
+		{ "load_large", 10000, 10000 * STATEMENTS, 1, 0.01, 0.002, [&]() { mtl::Load load; load.load(large.data(), large.size()); } },
+		{ "load_file", 10000, 10000 * STATEMENTS, 1, 0.01, 0.002, [&]() { mtl::Load load; load.load(path); } },
+		{ "lookup", 10000, 0, 1, 0.01, 0, [&]()
+		{
+			mtl::Material material;
+
+			char name[32];
+
+			for (size_t i = 0; i < 10000; i++)
+			{
+				snprintf(name, sizeof name, "material_%zu", i);
+
+				loaded.lookup(name, material);
+			}
+		} },
+		{ "trace", 1000, 0, 1, 0.05, 0, [&]()
+		{
+			auto* buffer = std::cout.rdbuf(sink.rdbuf());
+
+			mtl::trace(traced);
+
+			std::cout.rdbuf(buffer);
+
+			sink.str(std::string());
+		} }
+	};
+
+	Counters counters;
+
+	if (!counters.available())
+		fprintf(stderr, "bench: hardware counters not available, reporting wall time only\n");
+
+	mtl::JsonWriter out(stdout);
+
+	bool regression(false);
+
+	if (json) out.open('[');
+
+	for (const auto& scenario : scenarios)
+	{
+		if (!filter.empty() && std::find(filter.begin(), filter.end(), scenario.name) == filter.end())
+			continue;
+
+		const auto result = measure(scenario, runs * scenario.scale, counters);
+
+		regression |= result.regression;
+
+		if (json)
+			print(result, out);
+		else
+			print(result);
+
+		fflush(stdout);
+	}
+
+	if (json)
+	{
+		out.close(']');
+		out.flush();
+
+		printf("\n");
+	}
+
+	remove(path.c_str());
+
+	if (regression)
+		fprintf(stderr, "bench: allocations over the limit of a scenario\n");
+
+	return regression ? 1 : 0;
+}
@@ -0,0 +1,343 @@
+/*
+  mtlconv.cpp
+
+  Command line tool for converting Wavefront MTL libraries
+
+	mtlconv [--to mtl|bin|json|soa|arc] [-o folder] [-j threads] [--info] <file or directory> ...
+
+  Inputs are read as text MTL, binary cache (.mtlb), JSON (.json) or archive
+  (.mtla) by their extension. Directories are crawled recursively for *.mtl files and converted
+  to the same relative path below the output folder, or next to the input if
+  no folder is given. Files are converted in parallel.
+
+	mtl    MTL text                                  (.mtl,  WriteMTL.h)
+	bin    Binary cache, decoded without parsing     (.mtlb, BinaryMTL.h)
+	json   JSON                                      (.json, JsonMTL.h)
+	soa    Packed structure of arrays GPU tables     (.mtls, PackMTL.h)
+	arc    Compressed columnar archive               (.mtla, ArchiveMTL.h)
+
+  --info prints format, size, materials and information lines of each input
+  instead of converting. Time and throughput of the read, decode, encode and
+  write stages are reported on stderr. "-o -" writes a single file to stdout.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#include "../ArchiveMTL.h"
+#include "../JsonMTL.h"
+#include "../PackMTL.h"
+#include "../WriteMTL.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+namespace
+{
+	namespace fs = std::filesystem;
+
+	enum class Format { mtl, bin, json, soa, arc };
+
+	const char* extensions[] = { ".mtl", ".mtlb", ".json", ".mtls", ".mtla" };
+
+	const char* formats[] = { "mtl", "bin", "json", "soa", "arc" };
+
+	struct Stage
+	{
+		const char* name;
+
+		std::atomic<uint64_t> nanoseconds{ 0 };
+
+		std::atomic<uint64_t> bytes{ 0 };
+
+		void add(std::chrono::steady_clock::time_point start, size_t size)
+		{
+			const auto elapsed = std::chrono::steady_clock::now() - start;
+
+			nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+
+			bytes.fetch_add(size, std::memory_order_relaxed);
+		}
+	};
+
+	struct Job
+	{
+		std::string input;
+		std::string output;
+	};
+
+	struct Options
+	{
+		Format      to = Format::bin;
+		std::string folder;
+		bool        info = false;
+	};
+
+	Stage stages[] = { { "read" }, { "decode" }, { "encode" }, { "write" } };
+
+	std::atomic<uint64_t> materials{ 0 };
+
+	std::atomic<uint64_t> failed{ 0 };
+
+	std::string lower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		return text;
+	}
+
+	Format format(const std::string& path)
+	{
+		const auto extension = lower(fs::path(path).extension().string());
+
+		if (extension == ".mtlb") return Format::bin;
+
+		if (extension == ".json") return Format::json;
+
+		if (extension == ".mtla") return Format::arc;
+
+		return Format::mtl;
+	}
+
+	void collect(const std::string& path, const Options& options, std::vector<Job>& jobs)
+	{
+		std::error_code error;
+
+		auto target = [&](const fs::path& file, const fs::path& relative)
+		{
+			if (options.info) return std::string();
+
+			if (options.folder == "-") return options.folder;
+
+			auto output = options.folder.empty() ? file : fs::path(options.folder) / relative;
+
+			return output.replace_extension(extensions[static_cast<int>(options.to)]).string();
+		};
+
+		if (!fs::is_directory(path, error))
+		{
+			jobs.push_back({ path, target(path, fs::path(path).filename()) });
+
+			return;
+		}
+
+		for (fs::recursive_directory_iterator it(path, fs::directory_options::skip_permission_denied, error), end; it != end; it.increment(error))
+		{
+			if (error) break;
+
+			if (!it->is_regular_file(error) || lower(it->path().extension().string()) != ".mtl") continue;
+
+			jobs.push_back({ it->path().string(), target(it->path(), fs::relative(it->path(), path, error)) });
+		}
+	}
+
+	bool read(const std::string& path, std::string& data)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		FILE* file = fopen(path.c_str(), "rb");
+
+		if (!file) return false;
+
+		data.clear();
+
+		char block[65536];
+
+		size_t count;
+
+		while ((count = fread(block, 1, sizeof block, file)) != 0)
+			data.append(block, count);
+
+		fclose(file);
+
+		stages[0].add(start, data.size());
+
+		return true;
+	}
+
+	bool write(const std::string& path, const std::string& data)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		FILE* file = stdout;
+
+		if (path != "-")
+		{
+			std::error_code error;
+
+			fs::create_directories(fs::path(path).parent_path(), error);
+
+			file = fopen(path.c_str(), "wb");
+		}
+
+		if (!file) return false;
+
+		bool good = fwrite(data.data(), 1, data.size(), file) == data.size();
+
+		if (file != stdout)
+			good = fclose(file) == 0 && good;
+
+		stages[3].add(start, data.size());
+
+		return good;
+	}
+
+	bool convert(const Job& job, const Options& options)
+	{
+		std::string data;
+
+		if (!read(job.input, data)) return false;
+
+		const Format from = format(job.input);
+
+		mtl::Load load;
+
+		auto start = std::chrono::steady_clock::now();
+
+		bool loaded(false);
+
+		switch (from)
+		{
+		case Format::bin:  loaded = mtl::from_binary(data.data(), data.size(), load); break;
+		case Format::json: loaded = mtl::from_json(data, load); break;
+		case Format::arc:  loaded = mtl::from_archive(data.data(), data.size(), load); break;
+		default:           loaded = load.load(data.data(), data.size()); break;
+		}
+
+		if (!loaded) return false;
+
+		stages[1].add(start, data.size());
+
+		materials.fetch_add(load.materials().size(), std::memory_order_relaxed);
+
+		if (options.info)
+		{
+			printf("%s: %s, %zu bytes, %zu materials, %zu information lines\n", job.input.c_str(), formats[static_cast<int>(from)],
+				data.size(), load.materials().size(), load.information().size());
+
+			return true;
+		}
+
+		if (fs::path(job.output) == fs::path(job.input))
+		{
+			fprintf(stderr, "%s: output would overwrite input\n", job.input.c_str());
+
+			return false;
+		}
+
+		start = std::chrono::steady_clock::now();
+
+		switch (options.to)
+		{
+		case Format::mtl:  data = mtl::to_mtl(load); break;
+		case Format::bin:  data = mtl::to_binary(load); break;
+		case Format::json: data = mtl::to_json(load); break;
+		case Format::soa:  data = mtl::to_pack(load); break;
+		case Format::arc:  data = mtl::to_archive(load); break;
+		}
+
+		stages[2].add(start, data.size());
+
+		return write(job.output, data);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+
+	size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<std::string> inputs;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--to" && i + 1 < argc)
+		{
+			const std::string name = argv[++i];
+
+			const auto found = std::find_if(std::begin(formats), std::end(formats), [&](const char* f) { return name == f; });
+
+			if (found == std::end(formats))
+			{
+				fprintf(stderr, "mtlconv: unknown format %s\n", name.c_str());
+
+				return 2;
+			}
+
+			options.to = static_cast<Format>(found - std::begin(formats));
+		}
+		else if (arg == "-o" && i + 1 < argc)
+			options.folder = argv[++i];
+		else if (arg == "-j" && i + 1 < argc)
+			threads = std::max(1, atoi(argv[++i]));
+		else if (arg == "--info")
+			options.info = true;
+		else
+			inputs.push_back(arg);
+	}
+
+	std::vector<Job> jobs;
+
+	for (const auto& input : inputs)
+		collect(input, options, jobs);
+
+	if (jobs.empty() || (options.folder == "-" && jobs.size() > 1))
+	{
+		fprintf(stderr, "usage: mtlconv [--to mtl|bin|json|soa|arc] [-o folder] [-j threads] [--info] <file or directory> ...\n");
+
+		return 2;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+
+	std::atomic<size_t> next(0);
+
+	std::vector<std::thread> workers;
+
+	for (size_t t = 0; t < std::min(threads, jobs.size()); t++)
+	{
+		workers.emplace_back([&]()
+		{
+			for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < jobs.size();)
+			{
+				if (convert(jobs[i], options)) continue;
+
+				failed.fetch_add(1, std::memory_order_relaxed);
+
+				fprintf(stderr, "%s: conversion failed\n", jobs[i].input.c_str());
+			}
+		});
+	}
+
+	for (auto& worker : workers)
+		worker.join();
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	fprintf(stderr, "%zu files, %llu materials, %llu failed, %.3f s\n", jobs.size(),
+		static_cast<unsigned long long>(materials.load()), static_cast<unsigned long long>(failed.load()), seconds);
+
+	for (const auto& stage : stages)
+	{
+		const double busy = stage.nanoseconds.load() * 1e-9;
+
+		const double mb = stage.bytes.load() / 1048576.0;
+
+		if (stage.bytes.load() == 0) continue;
+
+		fprintf(stderr, "  %-7s %10.1f MB %9.3f s %10.1f MB/s\n", stage.name, mb, busy, busy > 0 ? mb / busy : 0.0);
+	}
+
+	return failed.load() ? 1 : 0;
+}
@@ -0,0 +1,528 @@
+/*
+  mtld.cpp
+
+  Material server keeping parsed Wavefront MTL libraries resident
+
+	mtld [-s socket] [-i milliseconds] [-r root ...] [-n libraries] [-c connections] [-b bytes] [library.mtl ...]
+
+  Libraries given on the command line are loaded at start. Others are loaded
+  the first time a client asks for them, but only from below a root given
+  with -r; without a root only the libraries of the command line are served.
+  At most -n libraries (64 by default) are kept, every file is parsed with
+  the resource limits of Load (-b, 256 MB by default, is the largest file,
+  and 1 GB of parsed materials) and the socket and shared memory segments
+  are only accessible to the user running mtld.
+
+  Each library is kept as a binary cache and published in a shared memory
+  segment (SharedMTL.h). The files are checked
+  for a new size or modification time every interval (1000 ms by default)
+  and reloaded and republished when they change; a library that fails to
+  reload keeps the version that was loaded before.
+
+  Requests are answered over the Unix domain socket (server_socket() by
+  default) with the protocol of ClientMTL.h, one thread per connection for at
+  most -c connections (64 by default); further connections are closed until
+  one ends. On SIGINT or SIGTERM the connections are shut down, their threads
+  joined, and the socket and segments are removed.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#include "../ClientMTL.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	namespace fs = std::filesystem;
+
+	struct Library
+	{
+		std::string        path;    // Canonical path of the file
+		std::string        segment; // Shared memory segment
+		std::string        cache;   // Binary cache
+		mtl::Binary        binary;  // Over cache
+		uint64_t           version; // Published version
+		uintmax_t          size;    // File size when loaded
+		fs::file_time_type time;    // Modification time when loaded
+	};
+
+	std::mutex lock; // Guards libraries
+
+	std::map<std::string, std::shared_ptr<const Library>> libraries; // By canonical path
+
+	std::vector<std::string> roots; // Canonical folders libraries are loaded from on request
+
+	size_t capacity(64); // Maximum number of resident libraries
+
+	mtl::Limits limits; // Resource limits of every load
+
+	std::string socket_path;
+
+	std::atomic<int> listener{ -1 };
+
+	std::atomic<bool> running{ true };
+
+	std::mutex watching; // Guards the wait of the watcher
+
+	std::condition_variable wake; // Ends the wait of the watcher on shutdown
+
+	std::atomic<uint64_t> requests{ 0 };
+
+	std::atomic<uint64_t> reloads{ 0 };
+
+	std::string canonical(const std::string& path)
+	{
+		std::error_code error;
+
+		const auto full = fs::weakly_canonical(path, error);
+
+		return error ? path : full.string();
+	}
+
+	bool allowed(const std::string& path)
+	{
+		for (const auto& root : roots)
+			if (path.compare(0, root.size(), root) == 0 && (root.back() == '/' || path.size() == root.size() || path[root.size()] == '/'))
+				return true;
+
+		return false;
+	}
+
+	std::string segment(const std::string& path)
+	{
+		char name[40];
+
+		snprintf(name, sizeof name, "/mtld.%016llx", static_cast<unsigned long long>(mtl::NameHash::hash(socket_path + '\n' + path, 0)));
+
+		return name;
+	}
+
+	std::shared_ptr<const Library> read(const std::string& path)
+	{
+		std::error_code error;
+
+		auto library = std::make_shared<Library>();
+
+		library->path = path;
+		library->segment = segment(path);
+		library->size = fs::file_size(path, error);
+		library->time = fs::last_write_time(path, error);
+
+		if (error) return nullptr;
+
+		mtl::Load load;
+
+		load.limit(limits);
+
+		if (!load.load(path)) return nullptr;
+
+		library->cache = mtl::to_binary(load);
+
+		if (!library->binary.open(library->cache.data(), library->cache.size())) return nullptr;
+
+		if (!mtl::Shared::publish(library->segment, library->cache, &library->version))
+			fprintf(stderr, "mtld: %s: cannot publish %s\n", path.c_str(), library->segment.c_str());
+
+		return library;
+	}
+
+	std::shared_ptr<const Library> find(const std::string& name, std::string& message)
+	{
+		const std::string path = canonical(name);
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			const auto found = libraries.find(path);
+
+			if (found != libraries.end()) return found->second;
+		}
+
+		if (!allowed(path))
+			return message = name + " is not below a library root", nullptr;
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			if (libraries.size() >= capacity)
+				return message = "too many libraries, cannot load " + name, nullptr;
+		}
+
+		auto library = read(path); // Loaded outside the lock, the first one stored is kept
+
+		if (!library)
+			return message = "cannot load " + name, nullptr;
+
+		std::lock_guard<std::mutex> guard(lock);
+
+		const auto found = libraries.find(path);
+
+		if (found != libraries.end()) return found->second;
+
+		if (libraries.size() >= capacity)
+		{
+			mtl::Shared::remove(library->segment);
+
+			return message = "too many libraries, cannot load " + name, nullptr;
+		}
+
+		return libraries.emplace(path, library).first->second;
+	}
+
+	void watch(std::chrono::milliseconds interval)
+	{
+		while (running.load())
+		{
+			{
+				std::unique_lock<std::mutex> guard(watching);
+
+				if (wake.wait_for(guard, interval, []() { return !running.load(); })) break;
+			}
+
+			std::vector<std::shared_ptr<const Library>> current;
+
+			{
+				std::lock_guard<std::mutex> guard(lock);
+
+				for (const auto& item : libraries)
+					current.push_back(item.second);
+			}
+
+			for (const auto& library : current)
+			{
+				std::error_code error;
+
+				const auto size = fs::file_size(library->path, error);
+
+				const auto time = fs::last_write_time(library->path, error);
+
+				if (error || (size == library->size && time == library->time)) continue;
+
+				auto update = read(library->path);
+
+				if (!update)
+				{
+					fprintf(stderr, "mtld: %s: reload failed, keeping version %llu\n", library->path.c_str(), static_cast<unsigned long long>(library->version));
+
+					continue;
+				}
+
+				reloads.fetch_add(1);
+
+				std::lock_guard<std::mutex> guard(lock);
+
+				libraries[library->path] = update;
+			}
+		}
+	}
+
+	void fail(mtl::BinaryWriter& reply, const std::string& message)
+	{
+		reply.str().clear();
+		reply.put(static_cast<uint8_t>(1));
+		reply.put(message);
+	}
+
+	void record(const Library& library, std::string_view name, mtl::BinaryWriter& reply)
+	{
+		size_t index;
+
+		const char* data = nullptr;
+
+		const size_t size = library.binary.find(name, index) ? library.binary.record(index, data) : 0;
+
+		reply.put(static_cast<uint32_t>(size));
+
+		if (size) reply.put(data, size);
+	}
+
+	void answer(const std::string& frame, mtl::BinaryWriter& reply)
+	{
+		mtl::BinaryReader in(frame.data(), frame.size());
+
+		mtl::Request request;
+
+		std::string path;
+
+		reply.put(static_cast<uint8_t>(0));
+
+		if (!in.get(request)) return fail(reply, "bad request");
+
+		if (request == mtl::Request::stats)
+		{
+			std::string text = "requests " + std::to_string(requests.load()) + ", reloads " + std::to_string(reloads.load()) + "\n";
+
+			std::lock_guard<std::mutex> guard(lock);
+
+			for (const auto& item : libraries)
+			{
+				const auto& library = *item.second;
+
+				text += library.path + ": " + std::to_string(library.binary.size()) + " materials, " + std::to_string(library.cache.size()) +
+					" bytes, version " + std::to_string(library.version) + ", " + library.segment + "\n";
+			}
+
+			reply.put(text);
+
+			return;
+		}
+
+		if (!in.get(path)) return fail(reply, "bad request");
+
+		std::string message;
+
+		const auto library = find(path, message);
+
+		if (!library) return fail(reply, message);
+
+		std::string_view name;
+
+		switch (request)
+		{
+		case mtl::Request::load:
+			reply.put(library->segment);
+			break;
+
+		case mtl::Request::lookup:
+			if (!in.get(name)) return fail(reply, "bad request");
+
+			record(*library, name, reply);
+			break;
+
+		case mtl::Request::batch:
+		{
+			uint32_t count;
+
+			if (!in.get(count) || count > in.remaining() / sizeof(uint32_t)) return fail(reply, "bad request");
+
+			reply.put(count);
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (!in.get(name)) return fail(reply, "bad request");
+
+				record(*library, name, reply);
+			}
+
+			if (reply.size() > mtl::SERVER_FRAME_LIMIT) return fail(reply, "reply too large");
+
+			break;
+		}
+
+		default:
+			fail(reply, "unknown request");
+		}
+	}
+
+	void serve(int client)
+	{
+		std::string frame;
+
+		while (mtl::receive_frame(client, frame))
+		{
+			requests.fetch_add(1, std::memory_order_relaxed);
+
+			mtl::BinaryWriter reply;
+
+			answer(frame, reply);
+
+			if (!mtl::send_frame(client, reply.str())) break;
+		}
+	}
+
+	struct Worker
+	{
+		int               client = -1;    // Connection, closed by main after the join
+		std::atomic<bool> done{ false }; // serve returned
+		std::thread       thread;
+	};
+
+	std::list<Worker> workers; // Connections being served, main thread only
+
+	void reap(bool all)
+	{
+		for (auto worker = workers.begin(); worker != workers.end();)
+		{
+			if (!all && !worker->done.load())
+			{
+				++worker;
+
+				continue;
+			}
+
+			if (!worker->done.load()) shutdown(worker->client, SHUT_RDWR); // Wakes recv
+
+			worker->thread.join();
+
+			close(worker->client);
+
+			worker = workers.erase(worker);
+		}
+	}
+
+	void stop(int)
+	{
+		running.store(false);
+
+		const int fd = listener.load();
+
+		if (fd >= 0) shutdown(fd, SHUT_RDWR); // Wakes accept
+	}
+}
+
+int main(int argc, char** argv)
+{
+	socket_path = mtl::server_socket();
+
+	std::chrono::milliseconds interval(1000);
+
+	std::vector<std::string> preload;
+
+	size_t connections(64);
+
+	limits.bytes = 256u << 20;
+	limits.memory = 1u << 30; // Estimated, a material counts as sizeof(Material) plus its strings
+	limits.string = 1 << 16;
+	limits.information = 1 << 16;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "-s" && i + 1 < argc)
+			socket_path = argv[++i];
+		else if (arg == "-i" && i + 1 < argc)
+			interval = std::chrono::milliseconds(std::max(10, atoi(argv[++i])));
+		else if (arg == "-r" && i + 1 < argc)
+			roots.push_back(canonical(argv[++i]));
+		else if (arg == "-n" && i + 1 < argc)
+			capacity = static_cast<size_t>(std::max(1, atoi(argv[++i])));
+		else if (arg == "-c" && i + 1 < argc)
+			connections = static_cast<size_t>(std::max(1, atoi(argv[++i])));
+		else if (arg == "-b" && i + 1 < argc)
+			limits.bytes = static_cast<size_t>(std::max(1ll, atoll(argv[++i])));
+		else if (arg[0] == '-')
+		{
+			fprintf(stderr, "usage: mtld [-s socket] [-i milliseconds] [-r root ...] [-n libraries] [-c connections] [-b bytes] [library.mtl ...]\n");
+
+			return 2;
+		}
+		else
+			preload.push_back(arg);
+	}
+
+	sockaddr_un address = {};
+
+	address.sun_family = AF_UNIX;
+
+	if (socket_path.size() >= sizeof address.sun_path)
+	{
+		fprintf(stderr, "mtld: socket path too long\n");
+
+		return 2;
+	}
+
+	std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+	for (const auto& name : preload)
+	{
+		const std::string path = canonical(name);
+
+		auto library = libraries.size() < capacity ? read(path) : nullptr;
+
+		if (library)
+			libraries.emplace(path, library);
+		else
+			fprintf(stderr, "mtld: %s: cannot load\n", name.c_str());
+	}
+
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	unlink(socket_path.c_str());
+
+	// Owner only, set before listen so no other user can connect in between
+
+	if (fd < 0 || bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof address) != 0 || chmod(socket_path.c_str(), 0600) != 0 || listen(fd, 64) != 0)
+	{
+		fprintf(stderr, "mtld: cannot listen on %s\n", socket_path.c_str());
+
+		return 1;
+	}
+
+	listener.store(fd);
+
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+	signal(SIGPIPE, SIG_IGN);
+
+	fprintf(stderr, "mtld: listening on %s\n", socket_path.c_str());
+
+	std::thread watcher(watch, interval);
+
+	while (running.load())
+	{
+		const int client = accept(fd, nullptr, nullptr);
+
+		if (client < 0)
+		{
+			if (errno != EINTR) break;
+
+			continue;
+		}
+
+		reap(false);
+
+		if (workers.size() >= connections)
+		{
+			close(client); // Refused, the client sees the connection end
+
+			continue;
+		}
+
+		auto& worker = workers.emplace_back();
+
+		worker.client = client;
+
+		worker.thread = std::thread([&worker]() { serve(worker.client); worker.done.store(true); });
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(watching);
+
+		running.store(false);
+	}
+
+	wake.notify_all();
+
+	reap(true);
+
+	watcher.join();
+
+	close(fd);
+
+	unlink(socket_path.c_str());
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	for (const auto& item : libraries)
+		mtl::Shared::remove(item.second->segment);
+
+	return 0;
+}
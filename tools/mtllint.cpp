@@ -0,0 +1,199 @@
+/*
+  mtllint.cpp
+
+  Command line tool for validating Wavefront MTL files
+
+	mtllint [--json] [--no-files] [-j threads] <file or directory> ...
+
+  Every file is loaded with mtl::Load and checked with the rules of mtl::Lint.
+  Texture files are looked up relative to the folder of the MTL file unless
+  --no-files is given. Files are checked in parallel; a single large file is
+  checked with parallel materials instead. The exit code is 1 if any error was
+  found, which makes the tool usable as a pre-commit hook.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#include "../LintMTL.h"
+
+#include <atomic>
+#include <filesystem>
+
+namespace
+{
+	struct Result
+	{
+		std::string        path;
+		bool               loaded;
+		std::vector<mtl::Issue> issues;
+	};
+
+	void collect(const std::string& path, std::vector<std::string>& files)
+	{
+		namespace fs = std::filesystem;
+
+		std::error_code error;
+
+		if (!fs::is_directory(path, error))
+		{
+			files.push_back(path);
+
+			return;
+		}
+
+		for (fs::recursive_directory_iterator it(path, fs::directory_options::skip_permission_denied, error), end; it != end; it.increment(error))
+		{
+			if (error) break;
+
+			if (!it->is_regular_file(error)) continue;
+
+			auto extension = it->path().extension().string();
+
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+			if (extension == ".mtl")
+				files.push_back(it->path().string());
+		}
+	}
+
+	Result lint(const std::string& path, bool textures, size_t threads)
+	{
+		Result result{ path, false, {} };
+
+		mtl::Load load;
+
+		result.loaded = load.load(path);
+
+		if (!result.loaded) return result;
+
+		std::string folder;
+
+		if (textures)
+		{
+			folder = std::filesystem::path(path).parent_path().string();
+
+			if (folder.empty()) folder = ".";
+		}
+
+		const mtl::Lint rules(folder);
+
+		result.issues = rules.check(load, threads);
+
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool json(false);
+
+	bool textures(true);
+
+	size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--json")
+			json = true;
+		else if (arg == "--no-files")
+			textures = false;
+		else if (arg == "-j" && i + 1 < argc)
+			threads = std::max(1, atoi(argv[++i]));
+		else
+			collect(arg, files);
+	}
+
+	if (files.empty())
+	{
+		fprintf(stderr, "usage: mtllint [--json] [--no-files] [-j threads] <file or directory> ...\n");
+
+		return 2;
+	}
+
+	std::vector<Result> results(files.size());
+
+	if (files.size() == 1)
+		results[0] = lint(files[0], textures, threads);
+	else
+	{
+		std::atomic<size_t> next(0);
+
+		std::vector<std::thread> workers;
+
+		for (size_t t = 0; t < std::min(threads, files.size()); t++)
+		{
+			workers.emplace_back([&]()
+			{
+				for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < files.size();)
+					results[i] = lint(files[i], textures, 1);
+			});
+		}
+
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	size_t errors(0);
+
+	size_t warnings(0);
+
+	mtl::JsonWriter out(stdout);
+
+	if (json) out.open('[');
+
+	for (const auto& result : results)
+	{
+		if (!result.loaded)
+		{
+			errors++;
+
+			const mtl::Issue issue{ "load", mtl::Severity::error, 0, "", "", "file could not be loaded" };
+
+			if (json)
+				mtl::to_json({ issue }, result.path, out);
+			else
+				printf("%s: error: [load] file could not be loaded\n", result.path.c_str());
+
+			continue;
+		}
+
+		for (const auto& issue : result.issues)
+			(issue.severity == mtl::Severity::error ? errors : warnings)++;
+
+		if (json)
+		{
+			mtl::to_json(result.issues, result.path, out);
+
+			continue;
+		}
+
+		for (const auto& issue : result.issues)
+		{
+			printf("%s: %s: [%s] %s: %s: %s\n", result.path.c_str(), issue.severity == mtl::Severity::error ? "error" : "warning",
+				issue.rule.c_str(), issue.name.c_str(), issue.keyword.c_str(), issue.message.c_str());
+		}
+	}
+
+	if (json)
+	{
+		out.close(']');
+		out.flush();
+
+		printf("\n");
+	}
+	else
+		fprintf(stderr, "%zu files, %zu errors, %zu warnings\n", files.size(), errors, warnings);
+
+	return errors ? 1 : 0;
+}
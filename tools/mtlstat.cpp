@@ -0,0 +1,473 @@
+/*
+  mtlstat.cpp
+
+  Command line tool for corpus statistics over Wavefront MTL files
+
+	mtlstat [--json] [--files] [-j threads] <file or directory> ...
+
+  Directories are crawled recursively for *.mtl files. Files are parsed in
+  parallel with mtl::Load and the statement frequency, material counts,
+  texture option usage, file sizes and parse times are aggregated in lock-free
+  counters. --files also lists size, materials and parse time per file, with
+  --json as the "per_file" array of the document.
+
+  Copyright (c) 2023 Stefan Falk Johnsen
+
+  This software is released under the terms of the
+  GNU General Public License v3.0. Details and terms of this
+  license can be found at: https://www.gnu.org/licenses/gpl-3.0.html
+  For those who require the freedom to operate without the
+  constraints of the GPL, a commercial license can be obtaining by
+  contacting the author at stefan.johnsen@outlook.com
+  */
+
+#include "../WavefrontMTL.h"
+#include "../JsonMTL.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	constexpr size_t BUCKETS = 40; // Power of two histogram buckets
+
+	struct Counter
+	{
+		std::atomic<uint64_t> value{ 0 };
+
+		void add(uint64_t n) { value.fetch_add(n, std::memory_order_relaxed); }
+
+		uint64_t get() const { return value.load(std::memory_order_relaxed); }
+	};
+
+	struct Record
+	{
+		std::string path;
+		size_t      bytes;
+		size_t      materials;
+		double      us;     // Parse time in microseconds
+		bool        loaded;
+	};
+
+	struct Statistics
+	{
+		explicit Statistics(size_t keywords) : statements(new Counter[keywords]) {}
+
+		std::unique_ptr<Counter[]> statements; // Statement frequency by keyword id
+
+		Counter unknown;     // Statements not known by the parser
+		Counter comments;    // Comment lines
+		Counter files;       // Files parsed
+		Counter failed;      // Files that could not be loaded
+		Counter bytes;       // Total size
+		Counter materials;   // Total number of materials
+		Counter nanoseconds; // Total parse time
+
+		Counter options[12];          // Texture option usage (visit_options order)
+		Counter sizes[BUCKETS];       // Histogram of file size, bucket is log2(bytes)
+		Counter times[BUCKETS];       // Histogram of parse time, bucket is log2(microseconds)
+		Counter counts[BUCKETS];      // Histogram of materials per file, bucket is log2(materials)
+	};
+
+	size_t bucket(uint64_t value)
+	{
+		size_t n(0);
+
+		while (value > 1 && n < BUCKETS - 1)
+		{
+			value >>= 1;
+			n++;
+		}
+
+		return n;
+	}
+
+	bool read(const std::string& path, std::vector<char>& data)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+
+		if (!file) return false;
+
+		data.clear();
+
+		char block[65536];
+
+		size_t count;
+
+		while ((count = fread(block, 1, sizeof block, file)) != 0)
+			data.insert(data.end(), block, block + count);
+
+		fclose(file);
+
+		return true;
+	}
+
+	void scan(const std::vector<char>& data, const mtl::Dispatch& dispatch, Statistics& stats)
+	{
+		mtl::Reader reader(data.data(), data.size());
+
+		char buff[mtl::BUFFER_CHAR];
+
+		size_t length;
+
+		while (reader.next(buff, sizeof buff))
+		{
+			char* line = mtl::trim(buff);
+
+			if (*line == '#')
+			{
+				stats.comments.add(1);
+
+				continue;
+			}
+
+			char* args = mtl::split(line, length);
+
+			if (!args) continue;
+
+			if (length == 6 && mtl::char_cmp(line, "newmtl"))
+				continue;
+
+			const auto* keyword = dispatch.find(line, length);
+
+			if (keyword)
+				stats.statements[keyword->id].add(1);
+			else
+				stats.unknown.add(1);
+		}
+	}
+
+	void options(mtl::Load& load, Statistics& stats)
+	{
+		for (const auto& material : load.materials())
+		{
+			auto texture = [&](const mtl::Texture& texture)
+			{
+				if (!texture.isParsed()) return;
+
+				size_t n(0);
+
+				mtl::visit_options(texture, [&](const char*, const mtl::Parse& option)
+				{
+					if (option.isParsed())
+						stats.options[n].add(1);
+
+					n++;
+				});
+			};
+
+			mtl::visit(material, [&](const char*, const auto& field)
+			{
+				using T = typename std::decay<decltype(field)>::type;
+
+				if constexpr (std::is_same<T, mtl::Texture>::value)
+					texture(field);
+
+				if constexpr (std::is_same<T, mtl::Reflection>::value)
+					mtl::visit_reflection(field, [&](const char*, const mtl::Texture& item) { texture(item); });
+			});
+		}
+	}
+
+	Record process(const std::string& path, const mtl::Dispatch& dispatch, Statistics& stats, std::vector<char>& data)
+	{
+		Record record{ path, 0, 0, 0, false };
+
+		if (!read(path, data))
+		{
+			stats.failed.add(1);
+
+			return record;
+		}
+
+		mtl::Load load;
+
+		const auto start = std::chrono::steady_clock::now();
+
+		record.loaded = load.load(data.data(), data.size());
+
+		const auto stop = std::chrono::steady_clock::now();
+
+		const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+
+		record.bytes = data.size();
+		record.us = ns / 1000.0;
+		record.materials = record.loaded ? load.materials().size() : 0;
+
+		stats.files.add(1);
+		stats.bytes.add(record.bytes);
+		stats.nanoseconds.add(ns);
+		stats.sizes[bucket(record.bytes)].add(1);
+		stats.times[bucket(static_cast<uint64_t>(record.us))].add(1);
+
+		if (!record.loaded)
+		{
+			stats.failed.add(1);
+
+			return record;
+		}
+
+		stats.materials.add(record.materials);
+		stats.counts[bucket(record.materials)].add(1);
+
+		scan(data, dispatch, stats);
+
+		options(load, stats);
+
+		return record;
+	}
+
+	void collect(const std::string& path, std::vector<std::string>& files)
+	{
+		namespace fs = std::filesystem;
+
+		std::error_code error;
+
+		if (!fs::is_directory(path, error))
+		{
+			files.push_back(path);
+
+			return;
+		}
+
+		for (fs::recursive_directory_iterator it(path, fs::directory_options::skip_permission_denied, error), end; it != end; it.increment(error))
+		{
+			if (error) break;
+
+			if (!it->is_regular_file(error)) continue;
+
+			auto extension = it->path().extension().string();
+
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+			if (extension == ".mtl")
+				files.push_back(it->path().string());
+		}
+	}
+
+	const char* option_names[] = { "blendu", "blendv", "clamp", "cc", "bm", "boost", "texres", "mm", "o", "s", "t", "imfchan" };
+
+	void histogram(mtl::JsonWriter& out, const char* name, const Counter* buckets)
+	{
+		out.key(name);
+		out.open('[');
+
+		for (size_t i = 0; i < BUCKETS; i++)
+			out.number(static_cast<double>(buckets[i].get()));
+
+		out.close(']');
+	}
+
+	void print_json(mtl::JsonWriter& out, const Record& record)
+	{
+		out.open('{');
+		out.key("path"); out.string(record.path);
+		out.key("loaded"); out.boolean(record.loaded);
+		out.key("bytes"); out.number(static_cast<double>(record.bytes));
+		out.key("materials"); out.number(static_cast<double>(record.materials));
+		out.key("us"); out.number(record.us);
+		out.close('}');
+	}
+
+	void print_json(const Statistics& stats, const mtl::Dispatch& dispatch, const std::vector<Record>& slowest, const std::vector<Record>* list)
+	{
+		mtl::JsonWriter out(stdout);
+
+		out.open('{');
+
+		out.key("files"); out.number(static_cast<double>(stats.files.get()));
+		out.key("failed"); out.number(static_cast<double>(stats.failed.get()));
+		out.key("bytes"); out.number(static_cast<double>(stats.bytes.get()));
+		out.key("materials"); out.number(static_cast<double>(stats.materials.get()));
+		out.key("parse_seconds"); out.number(stats.nanoseconds.get() / 1e9);
+		out.key("comments"); out.number(static_cast<double>(stats.comments.get()));
+		out.key("unknown"); out.number(static_cast<double>(stats.unknown.get()));
+
+		out.key("statements");
+		out.open('{');
+
+		for (size_t i = 0; i < dispatch.size(); i++)
+		{
+			out.key(dispatch.keyword(i).name.c_str());
+			out.number(static_cast<double>(stats.statements[i].get()));
+		}
+
+		out.close('}');
+
+		out.key("texture_options");
+		out.open('{');
+
+		for (size_t i = 0; i < 12; i++)
+		{
+			out.key(option_names[i]);
+			out.number(static_cast<double>(stats.options[i].get()));
+		}
+
+		out.close('}');
+
+		histogram(out, "size_log2_bytes", stats.sizes);
+		histogram(out, "time_log2_us", stats.times);
+		histogram(out, "materials_log2", stats.counts);
+
+		out.key("slowest");
+		out.open('[');
+
+		for (const auto& record : slowest)
+			print_json(out, record);
+
+		out.close(']');
+
+		if (list)
+		{
+			out.key("per_file");
+			out.open('[');
+
+			for (const auto& record : *list)
+			{
+				print_json(out, record);
+
+				out.flush();
+			}
+
+			out.close(']');
+		}
+
+		out.close('}');
+
+		out.flush();
+
+		printf("\n");
+	}
+
+	void print_text(const Statistics& stats, const mtl::Dispatch& dispatch, const std::vector<Record>& slowest)
+	{
+		const double seconds = stats.nanoseconds.get() / 1e9;
+
+		printf("files      %llu (%llu failed)\n", (unsigned long long)stats.files.get(), (unsigned long long)stats.failed.get());
+		printf("bytes      %llu\n", (unsigned long long)stats.bytes.get());
+		printf("materials  %llu\n", (unsigned long long)stats.materials.get());
+		printf("parse      %.3f s (%.1f MB/s per thread)\n", seconds, seconds > 0 ? stats.bytes.get() / seconds / 1e6 : 0.0);
+		printf("comments   %llu\n", (unsigned long long)stats.comments.get());
+		printf("unknown    %llu\n", (unsigned long long)stats.unknown.get());
+
+		std::vector<std::pair<uint64_t, size_t>> order;
+
+		for (size_t i = 0; i < dispatch.size(); i++)
+			order.emplace_back(stats.statements[i].get(), i);
+
+		std::sort(order.rbegin(), order.rend());
+
+		printf("\nstatements\n");
+
+		for (const auto& item : order)
+			if (item.first)
+				printf("  %-12s %llu\n", dispatch.keyword(item.second).name.c_str(), (unsigned long long)item.first);
+
+		printf("\ntexture options\n");
+
+		for (size_t i = 0; i < 12; i++)
+			printf("  -%-11s %llu\n", option_names[i], (unsigned long long)stats.options[i].get());
+
+		auto print = [](const char* title, const char* unit, const Counter* buckets)
+		{
+			printf("\n%s\n", title);
+
+			for (size_t i = 0; i < BUCKETS; i++)
+				if (buckets[i].get())
+					printf("  < %-12llu %s %llu\n", 2ull << i, unit, (unsigned long long)buckets[i].get());
+		};
+
+		print("file size", "bytes", stats.sizes);
+		print("parse time", "us   ", stats.times);
+		print("materials per file", "     ", stats.counts);
+
+		printf("\nslowest\n");
+
+		for (const auto& record : slowest)
+			printf("  %10.1f us %10zu bytes %6zu materials  %s\n", record.us, record.bytes, record.materials, record.path.c_str());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool json(false);
+
+	bool list(false);
+
+	size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--json")
+			json = true;
+		else if (arg == "--files")
+			list = true;
+		else if (arg == "-j" && i + 1 < argc)
+			threads = std::max(1, atoi(argv[++i]));
+		else
+			collect(arg, files);
+	}
+
+	if (files.empty())
+	{
+		fprintf(stderr, "usage: mtlstat [--json] [--files] [-j threads] <file or directory> ...\n");
+
+		return 1;
+	}
+
+	const mtl::Dispatch dispatch;
+
+	Statistics stats(dispatch.size());
+
+	std::atomic<size_t> next(0);
+
+	std::vector<std::vector<Record>> records(threads);
+
+	std::vector<std::thread> workers;
+
+	for (size_t t = 0; t < threads; t++)
+	{
+		workers.emplace_back([&, t]()
+		{
+			std::vector<char> data;
+
+			for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < files.size();)
+				records[t].push_back(process(files[i], dispatch, stats, data));
+		});
+	}
+
+	for (auto& worker : workers)
+		worker.join();
+
+	std::vector<Record> all;
+
+	for (auto& list : records)
+		all.insert(all.end(), list.begin(), list.end());
+
+	std::sort(all.begin(), all.end(), [](const Record& a, const Record& b) { return a.us > b.us; });
+
+	if (list && !json) // JSON output lists the files inside the document
+	{
+		for (const auto& record : all)
+			printf("%s\t%zu\t%zu\t%.1f\t%s\n", record.loaded ? "ok" : "fail", record.bytes, record.materials, record.us, record.path.c_str());
+
+		printf("\n");
+	}
+
+	const std::vector<Record> slowest(all.begin(), all.begin() + std::min<size_t>(10, all.size()));
+
+	if (json)
+		print_json(stats, dispatch, slowest, list ? &all : nullptr);
+	else
+		print_text(stats, dispatch, slowest);
+
+	return stats.failed.get() ? 2 : 0;
+}